@@ -0,0 +1,78 @@
+#pragma once
+#include <cmath>
+
+//axis aligned bounding box in world coordinates, boxes that only touch along an edge do not overlap
+struct AABB
+{
+	float minX, minY;
+	float maxX, maxY;
+
+	bool Overlaps(const AABB& other) const
+	{
+		return minX < other.maxX && maxX > other.minX &&
+			minY < other.maxY && maxY > other.minY;
+	}
+
+	bool Contains(float x, float y) const
+	{
+		return x > minX && x < maxX && y > minY && y < maxY;
+	}
+
+	//box covering both this box and the same box moved by dX, dY
+	AABB Swept(float dX, float dY) const
+	{
+		return { dX < 0 ? minX + dX : minX, dY < 0 ? minY + dY : minY,
+			dX > 0 ? maxX + dX : maxX, dY > 0 ? maxY + dY : maxY };
+	}
+
+	//time of impact of this box moving by dX, dY against another box, as a fraction of the move in [0, 1), along with the normal of the face hit
+	//returns false if the boxes don't meet during the move, boxes that already overlap don't hit either so they can be moved apart
+	bool Sweep(float dX, float dY, const AABB& other, float& time, float& normalX, float& normalY) const
+	{
+		float entryX, exitX, entryY, exitY;
+		if (!SweepAxis(minX, maxX, other.minX, other.maxX, dX, entryX, exitX) ||
+			!SweepAxis(minY, maxY, other.minY, other.maxY, dY, entryY, exitY))
+			return false;
+
+		//the boxes meet once they overlap on both axes and stop when they are apart on either
+		float entry = entryX > entryY ? entryX : entryY;
+		float exit = exitX < exitY ? exitX : exitY;
+		if (entry < 0 || entry >= 1 || entry >= exit)
+			return false;
+
+		time = entry;
+		normalX = entryX > entryY ? (dX > 0 ? -1.0f : 1.0f) : 0;
+		normalY = entryX > entryY ? 0 : (dY > 0 ? -1.0f : 1.0f);
+		return true;
+	}
+
+	//box grown by the given margin on every side
+	AABB Inflated(float margin) const
+	{
+		return { minX - margin, minY - margin, maxX + margin, maxY + margin };
+	}
+
+private:
+	//fractions of the move at which a moving interval starts and stops overlapping another one, false if it never overlaps it
+	static bool SweepAxis(float min, float max, float otherMin, float otherMax, float d, float& entry, float& exit)
+	{
+		if (d > 0)
+		{
+			entry = (otherMin - max) / d;
+			exit = (otherMax - min) / d;
+		}
+		else if (d < 0)
+		{
+			entry = (otherMax - min) / d;
+			exit = (otherMin - max) / d;
+		}
+		else
+		{
+			//not moving on this axis, it overlaps for the whole move or never
+			entry = -INFINITY;
+			exit = INFINITY;
+			return min < otherMax && max > otherMin;
+		}
+		return true;
+	}
+};
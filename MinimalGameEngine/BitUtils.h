@@ -0,0 +1,45 @@
+#pragma once
+#include <SDL/SDL.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//index of the lowest set bit of a non zero word
+inline int LowestBit(Uint64 word)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, word);
+	return (int)index;
+#elif defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	int index = 0;
+	while (!(word & 1))
+	{
+		word >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+//index of the highest set bit of a non zero word
+inline int HighestBit(Uint64 word)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, word);
+	return (int)index;
+#elif defined(__GNUC__)
+	return 63 - __builtin_clzll(word);
+#else
+	int index = 63;
+	while (!(word & ((Uint64)1 << 63)))
+	{
+		word <<= 1;
+		index--;
+	}
+	return index;
+#endif
+}
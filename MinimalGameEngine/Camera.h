@@ -0,0 +1,61 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <cmath>
+#include "EntityHandles.h"
+
+//the part of the level shown in the window, x and y are the world position of the view's top left corner
+//before every frame the engine centers it on its target, if it has one, and keeps it inside the level
+class Camera
+{
+public:
+	float x = 0, y = 0;
+	int width = 0, height = 0; //size of the view, the window's size
+	EntityHandle target = INVALID_ENTITY; //entity to follow, the view is centered on it
+	bool clamp = true; //keeps the view inside the level, levels smaller than the view are shown from their top left corner
+	float worldWidth = 0, worldHeight = 0; //size of the level in pixels
+
+	//moves the view so the given world position is at its center
+	void CenterOn(float worldX, float worldY)
+	{
+		x = worldX - width / 2.0f;
+		y = worldY - height / 2.0f;
+	}
+
+	//keeps the view inside the level if clamp is set
+	void Clamp()
+	{
+		if (!clamp)
+			return;
+		x = SDL_max(0.0f, SDL_min(x, worldWidth - width));
+		y = SDL_max(0.0f, SDL_min(y, worldHeight - height));
+	}
+
+	//the view is drawn at whole pixels so the level doesn't shimmer while it scrolls
+	int ViewX() const
+	{
+		return (int)floorf(x);
+	}
+
+	int ViewY() const
+	{
+		return (int)floorf(y);
+	}
+
+	//the view as a rectangle in world coordinates
+	SDL_Rect View() const
+	{
+		return { ViewX(), ViewY(), width, height };
+	}
+
+	void WorldToScreen(float worldX, float worldY, int& screenX, int& screenY) const
+	{
+		screenX = (int)floorf(worldX) - ViewX();
+		screenY = (int)floorf(worldY) - ViewY();
+	}
+
+	void ScreenToWorld(int screenX, int screenY, float& worldX, float& worldY) const
+	{
+		worldX = (float)(screenX + ViewX());
+		worldY = (float)(screenY + ViewY());
+	}
+};
@@ -0,0 +1,177 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "BitUtils.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define COLLISIONKERNELS_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+//gcc and clang only emit avx2 code in functions that ask for it, msvc accepts the intrinsics anywhere
+#if defined(COLLISIONKERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define COLLISIONKERNELS_AVX2 __attribute__((target("avx2")))
+#define COLLISIONKERNELS_SSE2 __attribute__((target("sse2")))
+#else
+#define COLLISIONKERNELS_AVX2
+#define COLLISIONKERNELS_SSE2
+#endif
+
+//batched collision tests over the position arrays of the EntityStore (or any other pair of x, y arrays):
+//a kernel writes the index of every candidate with minX < xs[i] < maxX and minY < ys[i] < maxY to hits and returns how many it wrote,
+//hits must have room for count indices. Testing a box or a point against ENTITYSIZE boxes centered on the candidates boils down
+//to this range test on the candidate centers, see the batched TestCollision variants of Entity
+typedef int (*CollisionKernel)(float minX, float maxX, float minY, float maxY, const float* xs, const float* ys, int count, Uint32* hits);
+
+//tests the candidates from first to count, the vector kernels use it for the tails that don't fill a register
+inline int CollisionKernelTail(float minX, float maxX, float minY, float maxY, const float* xs, const float* ys, int first, int count, Uint32* hits)
+{
+	int found = 0;
+	for (int i = first; i < count; i++)
+	{
+		//written without branches so the compiler keeps it a straight loop
+		hits[found] = (Uint32)i;
+		found += (xs[i] > minX) & (xs[i] < maxX) & (ys[i] > minY) & (ys[i] < maxY);
+	}
+	return found;
+}
+
+//reference implementation, used when the cpu has no vector unit we know of
+inline int CollisionKernelScalar(float minX, float maxX, float minY, float maxY, const float* xs, const float* ys, int count, Uint32* hits)
+{
+	return CollisionKernelTail(minX, maxX, minY, maxY, xs, ys, 0, count, hits);
+}
+
+#ifdef COLLISIONKERNELS_X86
+//4 candidates per step
+COLLISIONKERNELS_SSE2 inline int CollisionKernelSSE2(float minX, float maxX, float minY, float maxY, const float* xs, const float* ys, int count, Uint32* hits)
+{
+	__m128 loX = _mm_set1_ps(minX), hiX = _mm_set1_ps(maxX);
+	__m128 loY = _mm_set1_ps(minY), hiY = _mm_set1_ps(maxY);
+
+	int found = 0;
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(xs + i);
+		__m128 y = _mm_loadu_ps(ys + i);
+		__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(x, loX), _mm_cmplt_ps(x, hiX)),
+			_mm_and_ps(_mm_cmpgt_ps(y, loY), _mm_cmplt_ps(y, hiY)));
+
+		//compact the hit mask into indices, most steps have no hit at all
+		Uint64 mask = (Uint64)_mm_movemask_ps(inside);
+		while (mask)
+		{
+			hits[found++] = (Uint32)(i + LowestBit(mask));
+			mask &= mask - 1;
+		}
+	}
+	return found + CollisionKernelTail(minX, maxX, minY, maxY, xs, ys, i, count, hits + found);
+}
+
+//8 candidates per step
+COLLISIONKERNELS_AVX2 inline int CollisionKernelAVX2(float minX, float maxX, float minY, float maxY, const float* xs, const float* ys, int count, Uint32* hits)
+{
+	__m256 loX = _mm256_set1_ps(minX), hiX = _mm256_set1_ps(maxX);
+	__m256 loY = _mm256_set1_ps(minY), hiY = _mm256_set1_ps(maxY);
+
+	int found = 0;
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(xs + i);
+		__m256 y = _mm256_loadu_ps(ys + i);
+		__m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(x, loX, _CMP_GT_OQ), _mm256_cmp_ps(x, hiX, _CMP_LT_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(y, loY, _CMP_GT_OQ), _mm256_cmp_ps(y, hiY, _CMP_LT_OQ)));
+
+		Uint64 mask = (Uint64)_mm256_movemask_ps(inside);
+		while (mask)
+		{
+			hits[found++] = (Uint32)(i + LowestBit(mask));
+			mask &= mask - 1;
+		}
+	}
+	return found + CollisionKernelTail(minX, maxX, minY, maxY, xs, ys, i, count, hits + found);
+}
+#endif
+
+//picks the widest kernel the cpu supports, checked once on first use
+inline CollisionKernel SelectCollisionKernel()
+{
+#ifdef COLLISIONKERNELS_X86
+	if (SDL_HasAVX2())
+		return &CollisionKernelAVX2;
+	if (SDL_HasSSE2())
+		return &CollisionKernelSSE2;
+#endif
+	return &CollisionKernelScalar;
+}
+
+//tests every candidate with the best kernel available, see CollisionKernel for the contract
+inline int BatchTestRange(float minX, float maxX, float minY, float maxY, const float* xs, const float* ys, int count, Uint32* hits)
+{
+	static const CollisionKernel kernel = SelectCollisionKernel();
+	return kernel(minX, maxX, minY, maxY, xs, ys, count, hits);
+}
+
+//BENCHMARK---------------------------------------------------------------------------------------------------------------------
+
+//times each kernel against 10k, 100k and 1M random candidates and prints the speedup over the scalar one
+inline void BenchmarkCollisionKernels()
+{
+	struct NamedKernel
+	{
+		const char* name;
+		CollisionKernel kernel;
+		bool supported;
+	};
+	std::vector<NamedKernel> kernels;
+	kernels.push_back({ "scalar", &CollisionKernelScalar, true });
+#ifdef COLLISIONKERNELS_X86
+	kernels.push_back({ "sse2", &CollisionKernelSSE2, SDL_HasSSE2() == SDL_TRUE });
+	kernels.push_back({ "avx2", &CollisionKernelAVX2, SDL_HasAVX2() == SDL_TRUE });
+#endif
+
+	const int sizes[] = { 10000, 100000, 1000000 };
+	const int repeats = 50;
+	srand(1);
+	for (int count : sizes)
+	{
+		//candidates spread over a 16k pixel square, the query box catches around 10% of them
+		std::vector<float> xs(count), ys(count);
+		for (int i = 0; i < count; i++)
+		{
+			xs[i] = (float)(rand() % 16384);
+			ys[i] = (float)(rand() % 16384);
+		}
+		std::vector<Uint32> hits(count);
+
+		double scalarTime = 0;
+		for (const NamedKernel& named : kernels)
+		{
+			if (!named.supported)
+			{
+				std::cout << count << " candidates, " << named.name << ": not supported by this cpu" << std::endl;
+				continue;
+			}
+
+			int found = 0;
+			Uint64 start = SDL_GetPerformanceCounter();
+			for (int r = 0; r < repeats; r++)
+			{
+				//move the box around so no run can be skipped
+				float minX = (float)(r * 97 % 14000);
+				found += named.kernel(minX, minX + 1640, 0, 16384, xs.data(), ys.data(), count, hits.data());
+			}
+			double time = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() / repeats;
+			if (named.kernel == &CollisionKernelScalar)
+				scalarTime = time;
+
+			std::cout << count << " candidates, " << named.name << ": " << time * 1000000 << " us per batch, "
+				<< found / repeats << " hits, " << scalarTime / time << "x" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <algorithm>
+#include <vector>
+#include "EntityHandles.h"
+
+static const Uint8 CONTACT_BEGIN = 0; //the entities started touching this frame
+static const Uint8 CONTACT_STAY = 1; //the entities were already touching last frame
+static const Uint8 CONTACT_END = 2; //the entities stopped touching, or one of them was destroyed
+
+//an overlap between an entity of typeA and one of typeB, in the order the type pair was registered
+struct ContactEvent
+{
+	Uint8 kind;
+	EntityHandle a, b;
+	Uint16 typeA, typeB;
+};
+
+//keeps the contacts between registered type pairs from one frame to the next and turns them into begin, stay and end events
+//the engine adds the overlaps it finds during its collision phase, then Finish compares them with the previous frame's
+class ContactTracker
+{
+public:
+	//asks for the contacts between the two types, registering a pair twice has no effect
+	void Register(Uint16 typeA, Uint16 typeB)
+	{
+		for (const TypePair& pair : pairs)
+		{
+			if ((pair.a == typeA && pair.b == typeB) || (pair.a == typeB && pair.b == typeA))
+				return;
+		}
+		pairs.push_back({ typeA, typeB });
+	}
+
+	//forgets the current contacts without reporting their end, used when the whole scene goes away
+	void Reset()
+	{
+		previous.clear();
+		current.clear();
+		events.clear();
+	}
+
+	//records an overlap found this frame
+	void Add(EntityHandle a, EntityHandle b, Uint16 typeA, Uint16 typeB)
+	{
+		current.push_back({ CONTACT_STAY, a, b, typeA, typeB });
+	}
+
+	//builds this frame's events, both lists are sorted by handles so they are matched in a single merge
+	void Finish()
+	{
+		std::sort(current.begin(), current.end(), &Less);
+		events.clear();
+
+		size_t p = 0, c = 0;
+		while (p < previous.size() || c < current.size())
+		{
+			if (c == current.size() || (p < previous.size() && Less(previous[p], current[c])))
+			{
+				events.push_back(previous[p++]);
+				events.back().kind = CONTACT_END;
+			}
+			else if (p == previous.size() || Less(current[c], previous[p]))
+			{
+				events.push_back(current[c++]);
+				events.back().kind = CONTACT_BEGIN;
+			}
+			else
+			{
+				events.push_back(current[c++]);
+				events.back().kind = CONTACT_STAY;
+				p++;
+			}
+		}
+
+		previous.swap(current);
+		current.clear();
+	}
+
+public:
+	struct TypePair
+	{
+		Uint16 a, b;
+	};
+	std::vector<TypePair> pairs; //registered type pairs
+	std::vector<ContactEvent> events; //this frame's events
+
+private:
+	std::vector<ContactEvent> previous; //last frame's contacts
+	std::vector<ContactEvent> current; //contacts being added this frame
+
+	static bool Less(const ContactEvent& left, const ContactEvent& right)
+	{
+		return left.a != right.a ? left.a < right.a : left.b < right.b;
+	}
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <vector>
+
+static const int DIRTYRECTS_MAX = 128; //past this many regions a frame is cheaper to redraw whole than to merge and present piecewise
+
+//tracks the screen regions that change from one frame to the next: what was drawn last frame has to be erased,
+//what is drawn this frame has to be drawn, everything else on screen is still correct and doesn't need to be touched or presented
+class DirtyRectTracker
+{
+public:
+	//starts a frame for a screen of the given size, last frame's drawn regions become dirty
+	void BeginFrame(int width, int height)
+	{
+		screenWidth = width;
+		screenHeight = height;
+		dirty.assign(drawn.begin(), drawn.end());
+		drawn.clear();
+	}
+
+	//records a region drawn this frame, it is clipped to the screen
+	void AddDrawn(const SDL_Rect& rect)
+	{
+		SDL_Rect screen = { 0, 0, screenWidth, screenHeight };
+		SDL_Rect clipped;
+		if (!SDL_IntersectRect(&rect, &screen, &clipped))
+			return;
+
+		drawn.push_back(clipped);
+		dirty.push_back(clipped);
+	}
+
+	//merges overlapping dirty regions, returns false if the frame should be redrawn whole instead:
+	//when a full redraw was requested, or the regions are too many or cover more than threshold of the screen
+	bool Resolve(float threshold)
+	{
+		bool partial = !fullRedraw && dirty.size() <= (size_t)DIRTYRECTS_MAX;
+		fullRedraw = false;
+		if (!partial)
+			return false;
+
+		//union regions that touch until none do, so nothing is restored or presented twice
+		bool merged = true;
+		while (merged)
+		{
+			merged = false;
+			for (size_t i = 0; i < dirty.size() && !merged; i++)
+			{
+				for (size_t j = i + 1; j < dirty.size(); j++)
+				{
+					if (Touch(dirty[i], dirty[j]))
+					{
+						SDL_UnionRect(&dirty[i], &dirty[j], &dirty[i]);
+						dirty[j] = dirty.back();
+						dirty.pop_back();
+						merged = true;
+						break;
+					}
+				}
+			}
+		}
+
+		long long area = 0;
+		for (const SDL_Rect& rect : dirty)
+			area += (long long)rect.w * rect.h;
+		return area <= (long long)(threshold * screenWidth * screenHeight);
+	}
+
+	//makes the next frame a full redraw, e.g. after the static layer changed or the window was exposed
+	void RequestFullRedraw()
+	{
+		fullRedraw = true;
+	}
+
+public:
+	std::vector<SDL_Rect> dirty; //regions to restore and present this frame, valid after Resolve returned true
+
+private:
+	std::vector<SDL_Rect> drawn; //regions drawn this frame
+	int screenWidth = 0, screenHeight = 0;
+	bool fullRedraw = true;
+
+	static bool Touch(const SDL_Rect& a, const SDL_Rect& b)
+	{
+		return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+	}
+};
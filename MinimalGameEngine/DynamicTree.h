@@ -0,0 +1,439 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <vector>
+#include "AABB.h"
+#include "EntityHandles.h"
+#include "SweepAndPrune.h"
+
+static const Sint32 DYNAMICTREE_NULL = -1;
+
+//a node of the tree, leaves hold an entity and a fat box around it, inner nodes hold the union of their children's boxes
+struct DynamicTreeNode
+{
+	AABB box;
+	EntityHandle handle; //leaves only
+	Sint32 parent;
+	Sint32 child1, child2;
+	Sint32 height; //0 for leaves
+
+	bool IsLeaf() const
+	{
+		return child1 == DYNAMICTREE_NULL;
+	}
+};
+
+//bounding volume hierarchy of entities of any size, kept balanced with tree rotations as entities come and go
+//leaves store the entity's box grown by a margin (a fat box), so an entity moving a little stays inside it and the tree isn't touched,
+//when it leaves its fat box the leaf is reinserted and its ancestors are refit on the way up
+//queries walk the tree with a stack kept between calls, so a tree can only be queried from one thread at a time and not from inside a Query visitor
+class DynamicTree
+{
+public:
+	DynamicTree(float fatMargin = 0)
+	{
+		margin = fatMargin;
+	}
+
+public:
+	//removes every entity
+	void Clear()
+	{
+		nodes.clear();
+		freeNodes.clear();
+		leaves.clear();
+		root = DYNAMICTREE_NULL;
+	}
+
+	//adds an entity with the given box
+	void Insert(EntityHandle handle, const AABB& box)
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		if (leaves.size() <= index)
+			leaves.resize(index + 1, DYNAMICTREE_NULL);
+
+		Sint32 leaf = AllocateNode();
+		nodes[leaf].box = box.Inflated(margin);
+		nodes[leaf].handle = handle;
+		nodes[leaf].height = 0;
+		leaves[index] = leaf;
+		InsertLeaf(leaf);
+	}
+
+	//removes an entity
+	void Remove(EntityHandle handle)
+	{
+		Sint32 leaf = Find(handle);
+		if (leaf == DYNAMICTREE_NULL)
+			return;
+
+		RemoveLeaf(leaf);
+		FreeNode(leaf);
+		leaves[handle & ENTITYHANDLE_INDEXMASK] = DYNAMICTREE_NULL;
+	}
+
+	//updates the box of an entity, returns true if it left its fat box and was reinserted
+	bool Move(EntityHandle handle, const AABB& box)
+	{
+		Sint32 leaf = Find(handle);
+		if (leaf == DYNAMICTREE_NULL)
+			return false;
+
+		const AABB& fat = nodes[leaf].box;
+		if (fat.minX <= box.minX && fat.minY <= box.minY && fat.maxX >= box.maxX && fat.maxY >= box.maxY)
+			return false;
+
+		RemoveLeaf(leaf);
+		nodes[leaf].box = box.Inflated(margin);
+		InsertLeaf(leaf);
+		return true;
+	}
+
+	//calls visit with the handle of every entity whose fat box overlaps the given box, visit returns false to stop
+	template <typename Visitor> void Query(const AABB& box, Visitor visit) const
+	{
+		if (root == DYNAMICTREE_NULL)
+			return;
+
+		stack.clear();
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			const DynamicTreeNode& node = nodes[stack.back()];
+			stack.pop_back();
+			if (!node.box.Overlaps(box))
+				continue;
+
+			if (node.IsLeaf())
+			{
+				if (!visit(node.handle))
+					return;
+			}
+			else
+			{
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+
+	//appends every pair of entities of this tree whose fat boxes overlap, each pair once
+	void QuerySelfPairs(std::vector<EntityPair>& pairs) const
+	{
+		if (root == DYNAMICTREE_NULL)
+			return;
+		pairStack.clear();
+		pairStack.push_back({ root, root, true });
+		FindPairs(*this, pairs);
+	}
+
+	//appends every pair made of an entity of this tree and one of the other tree whose fat boxes overlap, this tree's entity comes first
+	void QueryPairs(const DynamicTree& other, std::vector<EntityPair>& pairs) const
+	{
+		if (root == DYNAMICTREE_NULL || other.root == DYNAMICTREE_NULL)
+			return;
+		pairStack.clear();
+		pairStack.push_back({ root, other.root, false });
+		FindPairs(other, pairs);
+	}
+
+	//height of the tree, 0 when it holds a single entity
+	int Height() const
+	{
+		return root == DYNAMICTREE_NULL ? 0 : nodes[root].height;
+	}
+
+private:
+	//a subtree to pair with itself, or a subtree of this tree to pair with one of the other tree
+	struct PairTask
+	{
+		Sint32 index, otherIndex;
+		bool self;
+	};
+
+	std::vector<DynamicTreeNode> nodes;
+	mutable std::vector<Sint32> stack; //nodes left to visit by Query
+	mutable std::vector<PairTask> pairStack; //subtrees left to pair by QuerySelfPairs and QueryPairs
+	std::vector<Sint32> freeNodes;
+	std::vector<Sint32> leaves; //leaf of each entity, indexed by handle index
+	Sint32 root = DYNAMICTREE_NULL;
+	float margin;
+
+	Sint32 Find(EntityHandle handle) const
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		if (index >= leaves.size() || leaves[index] == DYNAMICTREE_NULL || nodes[leaves[index]].handle != handle)
+			return DYNAMICTREE_NULL;
+		return leaves[index];
+	}
+
+	Sint32 AllocateNode()
+	{
+		Sint32 index;
+		if (!freeNodes.empty())
+		{
+			index = freeNodes.back();
+			freeNodes.pop_back();
+		}
+		else
+		{
+			index = (Sint32)nodes.size();
+			nodes.push_back(DynamicTreeNode());
+		}
+		nodes[index].parent = DYNAMICTREE_NULL;
+		nodes[index].child1 = DYNAMICTREE_NULL;
+		nodes[index].child2 = DYNAMICTREE_NULL;
+		nodes[index].handle = INVALID_ENTITY;
+		return index;
+	}
+
+	void FreeNode(Sint32 index)
+	{
+		nodes[index].handle = INVALID_ENTITY;
+		freeNodes.push_back(index);
+	}
+
+	static AABB Union(const AABB& a, const AABB& b)
+	{
+		return { SDL_min(a.minX, b.minX), SDL_min(a.minY, b.minY), SDL_max(a.maxX, b.maxX), SDL_max(a.maxY, b.maxY) };
+	}
+
+	static float Perimeter(const AABB& box)
+	{
+		return 2 * ((box.maxX - box.minX) + (box.maxY - box.minY));
+	}
+
+	//walks down to the sibling that grows the tree's total perimeter the least and pairs the leaf with it under a new node
+	void InsertLeaf(Sint32 leaf)
+	{
+		if (root == DYNAMICTREE_NULL)
+		{
+			root = leaf;
+			nodes[leaf].parent = DYNAMICTREE_NULL;
+			return;
+		}
+
+		AABB box = nodes[leaf].box;
+		Sint32 index = root;
+		while (!nodes[index].IsLeaf())
+		{
+			Sint32 child1 = nodes[index].child1, child2 = nodes[index].child2;
+			float perimeter = Perimeter(nodes[index].box);
+			float combined = Perimeter(Union(nodes[index].box, box));
+
+			//cost of pairing the leaf with this node, versus pushing it further down, every ancestor grows by the same amount either way
+			float cost = 2 * combined;
+			float inheritance = 2 * (combined - perimeter);
+			float cost1 = DescendCost(child1, box) + inheritance;
+			float cost2 = DescendCost(child2, box) + inheritance;
+			if (cost < cost1 && cost < cost2)
+				break;
+
+			index = cost1 < cost2 ? child1 : child2;
+		}
+
+		Sint32 sibling = index;
+		Sint32 oldParent = nodes[sibling].parent;
+		Sint32 newParent = AllocateNode();
+		nodes[newParent].parent = oldParent;
+		nodes[newParent].box = Union(box, nodes[sibling].box);
+		nodes[newParent].height = nodes[sibling].height + 1;
+		nodes[newParent].child1 = sibling;
+		nodes[newParent].child2 = leaf;
+		nodes[sibling].parent = newParent;
+		nodes[leaf].parent = newParent;
+
+		if (oldParent == DYNAMICTREE_NULL)
+			root = newParent;
+		else if (nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+
+		Refit(nodes[leaf].parent);
+	}
+
+	float DescendCost(Sint32 child, const AABB& box) const
+	{
+		float combined = Perimeter(Union(nodes[child].box, box));
+		return nodes[child].IsLeaf() ? combined : combined - Perimeter(nodes[child].box);
+	}
+
+	//takes a leaf out of the tree, its sibling takes the place of their parent
+	void RemoveLeaf(Sint32 leaf)
+	{
+		if (leaf == root)
+		{
+			root = DYNAMICTREE_NULL;
+			return;
+		}
+
+		Sint32 parent = nodes[leaf].parent;
+		Sint32 grandParent = nodes[parent].parent;
+		Sint32 sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+		if (grandParent == DYNAMICTREE_NULL)
+		{
+			root = sibling;
+			nodes[sibling].parent = DYNAMICTREE_NULL;
+			FreeNode(parent);
+			return;
+		}
+
+		if (nodes[grandParent].child1 == parent)
+			nodes[grandParent].child1 = sibling;
+		else
+			nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+
+		Refit(grandParent);
+	}
+
+	//walks up from a node rebalancing it and recomputing the boxes and heights of every ancestor
+	void Refit(Sint32 index)
+	{
+		while (index != DYNAMICTREE_NULL)
+		{
+			index = Balance(index);
+			DynamicTreeNode& node = nodes[index];
+			node.height = 1 + SDL_max(nodes[node.child1].height, nodes[node.child2].height);
+			node.box = Union(nodes[node.child1].box, nodes[node.child2].box);
+			index = node.parent;
+		}
+	}
+
+	//if one child of the node is more than one level taller than the other, rotates it up, returns the node now at the top
+	Sint32 Balance(Sint32 a)
+	{
+		DynamicTreeNode& A = nodes[a];
+		if (A.IsLeaf() || A.height < 2)
+			return a;
+
+		Sint32 b = A.child1, c = A.child2;
+		DynamicTreeNode& B = nodes[b];
+		DynamicTreeNode& C = nodes[c];
+		Sint32 balance = C.height - B.height;
+
+		if (balance > 1)
+		{
+			//rotate C up
+			Sint32 f = C.child1, g = C.child2;
+			DynamicTreeNode& F = nodes[f];
+			DynamicTreeNode& G = nodes[g];
+
+			C.child1 = a;
+			C.parent = A.parent;
+			A.parent = c;
+			ReplaceChild(C.parent, a, c);
+
+			if (F.height > G.height)
+			{
+				C.child2 = f;
+				A.child2 = g;
+				G.parent = a;
+				A.box = Union(B.box, G.box);
+				C.box = Union(A.box, F.box);
+				A.height = 1 + SDL_max(B.height, G.height);
+				C.height = 1 + SDL_max(A.height, F.height);
+			}
+			else
+			{
+				C.child2 = g;
+				A.child2 = f;
+				F.parent = a;
+				A.box = Union(B.box, F.box);
+				C.box = Union(A.box, G.box);
+				A.height = 1 + SDL_max(B.height, F.height);
+				C.height = 1 + SDL_max(A.height, G.height);
+			}
+			return c;
+		}
+
+		if (balance < -1)
+		{
+			//rotate B up
+			Sint32 d = B.child1, e = B.child2;
+			DynamicTreeNode& D = nodes[d];
+			DynamicTreeNode& E = nodes[e];
+
+			B.child1 = a;
+			B.parent = A.parent;
+			A.parent = b;
+			ReplaceChild(B.parent, a, b);
+
+			if (D.height > E.height)
+			{
+				B.child2 = d;
+				A.child1 = e;
+				E.parent = a;
+				A.box = Union(C.box, E.box);
+				B.box = Union(A.box, D.box);
+				A.height = 1 + SDL_max(C.height, E.height);
+				B.height = 1 + SDL_max(A.height, D.height);
+			}
+			else
+			{
+				B.child2 = e;
+				A.child1 = d;
+				D.parent = a;
+				A.box = Union(C.box, D.box);
+				B.box = Union(A.box, E.box);
+				A.height = 1 + SDL_max(C.height, D.height);
+				B.height = 1 + SDL_max(A.height, E.height);
+			}
+			return b;
+		}
+
+		return a;
+	}
+
+	//points parent (or the root) at newChild instead of oldChild
+	void ReplaceChild(Sint32 parent, Sint32 oldChild, Sint32 newChild)
+	{
+		if (parent == DYNAMICTREE_NULL)
+			root = newChild;
+		else if (nodes[parent].child1 == oldChild)
+			nodes[parent].child1 = newChild;
+		else
+			nodes[parent].child2 = newChild;
+	}
+
+	//pairs up the tasks on pairStack, the children are pushed in reverse so the pairs come out in depth first order
+	//a subtree paired with itself pairs each child with itself, then the two children together
+	//two subtrees are descended at once, always splitting the taller one, and only where their boxes overlap
+	void FindPairs(const DynamicTree& other, std::vector<EntityPair>& pairs) const
+	{
+		while (!pairStack.empty())
+		{
+			PairTask task = pairStack.back();
+			pairStack.pop_back();
+			const DynamicTreeNode& node = nodes[task.index];
+			if (task.self)
+			{
+				if (node.IsLeaf())
+					continue;
+				pairStack.push_back({ node.child1, node.child2, false });
+				pairStack.push_back({ node.child2, node.child2, true });
+				pairStack.push_back({ node.child1, node.child1, true });
+				continue;
+			}
+
+			const DynamicTreeNode& otherNode = other.nodes[task.otherIndex];
+			if (!node.box.Overlaps(otherNode.box))
+				continue;
+
+			if (node.IsLeaf() && otherNode.IsLeaf())
+				pairs.push_back({ node.handle, otherNode.handle });
+			else if (otherNode.IsLeaf() || (!node.IsLeaf() && node.height >= otherNode.height))
+			{
+				pairStack.push_back({ node.child2, task.otherIndex, false });
+				pairStack.push_back({ node.child1, task.otherIndex, false });
+			}
+			else
+			{
+				pairStack.push_back({ task.index, otherNode.child2, false });
+				pairStack.push_back({ task.index, otherNode.child1, false });
+			}
+		}
+	}
+};
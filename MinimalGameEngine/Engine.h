@@ -7,6 +7,20 @@
 #include <SDL/SDL_ttf.h>
 #include <vector>
 #include "Entity.h"
+#include "EntityArena.h"
+#include "EntityCommands.h"
+#include "SpatialHash.h"
+#include "SweepAndPrune.h"
+#include "DynamicTree.h"
+#include "ContactEvents.h"
+#include "TileMap.h"
+#include "Profiler.h"
+#include "InputRecorder.h"
+#include "WorkerPool.h"
+#include "DirtyRects.h"
+#include "SpriteAtlas.h"
+#include "RenderBatch.h"
+#include "Camera.h"
 #include <fstream>
 
 static const int UP = 0;
@@ -14,6 +28,29 @@ static const int RIGHT = 1;
 static const int DOWN = 2;
 static const int LEFT = 3;
 
+//pending level loads
+static const int NO_LEVEL = -1;
+static const int NEXT_LEVEL = -2;
+
+//candidate pairs per narrowphase task, the contacts are merged task by task so their order doesn't depend on the number of threads
+static const int CONTACT_CHUNK = 1024;
+
+//how far a moving entity can go before the dynamic tree has to reinsert it
+static const float DYNAMICTREE_MARGIN = ENTITYSIZE / 4;
+
+//how far past the view the static layer is baked, the camera can scroll this far before it has to be baked again
+static const int STATICLAYER_MARGIN = ENTITYSIZE * 4;
+
+//initial size of the buffers of the queries that need every result, MoveAndSlide and the view culling, they grow when it isn't enough
+static const int QUERY_CANDIDATES = 256;
+
+//an entity hit by MoveAndSlide, the normal is the one of the face that was hit and points towards the moving entity
+struct MoveContact
+{
+	EntityHandle other;
+	float normalX, normalY;
+};
+
 //returns the sign of a number
 //from: https://stackoverflow.com/questions/1903954/is-there-a-standard-sign-function-signum-sgn-in-c-c
 template <typename T> int sgn(T val) {
@@ -41,19 +78,53 @@ public:
 	int SCREEN_WIDTH = ENTITYSIZE * 16;
 	int SCREEN_HEIGHT = ENTITYSIZE * 16;
 
-	//scene graph
-	std::vector<Entity*>* entityesDB;
+	//scene graph, the entity data lives in the store's dense arrays, scene is the store's list of Entity views kept for existing code
+	std::vector<EntityPrototype>* entityesDB;
+	EntityStore* entities;
 	std::vector<Entity*>* scene;
 
 	//input
-	bool inputHeld[4];
-	bool inputPressed[4];
+	bool inputHeld[4] = {};
+	bool inputPressed[4] = {};
 
 	//utils
 	double deltaTime = 0;
 
+	//headless mode, set before calling Run: no window and no audio device are created, the game renders into an offscreen surface and runs unthrottled
+	bool headless = false;
+	int maxFrames = 0; //number of frames after which the engine quits, 0 means run until QuitGame is called
+
+	//fixed timestep, set before calling Run: Update is called tickRate times per second with a constant deltaTime and Render interpolates between the last two ticks
+	bool fixedTimeStep = false;
+	int tickRate = 60;
+	int maxCatchUpTicks = 5; //upper bound of ticks simulated in a single frame, time beyond that is dropped
+	double interpolationAlpha = 1; //how far the rendered frame is between the previous tick (0) and the current one (1)
+
+	//profiling, zones are only recorded while profiler.enabled is set, gameplay code can add its own with PROFILE_ZONE(eng->profiler, "Name")
+	Profiler profiler;
+	std::string traceExportPath = ""; //if set, the recorded frames are exported as a Chrome trace to this file when the engine terminates
+
+	//dirty rectangles, when the regions changed in a frame cover more than this fraction of the screen the whole frame is redrawn and presented
+	float dirtyRectThreshold = 0.5f;
+
+	//threads running the collision narrowphase, set before calling Run: 0 uses every cpu core, 1 keeps it on the main thread
+	int workerThreads = 0;
+
+	//set before calling Run: loads the resources, logs how long sprite blits take before and after their load time preparation, then quits
+	bool benchmarkBlits = false;
+
+	//set before calling Run: loads the first level, logs how long finding the pairs of its moving dynamic entities takes with sweep and prune and with the dynamic tree, then quits
+	bool benchmarkBroadphase = false;
+
+	//input recording, set before calling Run: every frame's input and delta time are saved to recordPath, or read back from replayPath instead of the keyboard
+	std::string recordPath = "";
+	std::string replayPath = "";
+
 	//graphics
-	std::vector<SDL_Surface*>* sprites;
+	Camera camera; //view on the level, set camera.target in Start to follow an entity
+	int renderBackend = RENDER_SURFACE; //set before calling Run: RENDER_SURFACE blits on the CPU, RENDER_SDL draws the same frame through an SDL_Renderer
+	SpriteAtlas spriteAtlas; //every sprite of the resources folder, packed at load time
+	std::string atlasCachePath = ""; //set before calling Run: the packed atlas is saved there and reused by later runs while the sprites don't change
 
 	//music and sounds
 	std::vector<Mix_Chunk*>* audioClips; //effects can be created using: https://jfxr.frozenfractal.com/
@@ -68,66 +139,459 @@ public:
 		{
 			isRunning = true;
 			AcquireResources();
+			OpenInputRecording();
+			if (benchmarkBlits || benchmarkBroadphase)
+			{
+				if (benchmarkBlits)
+					BenchmarkBlits();
+				if (benchmarkBroadphase)
+					BenchmarkBroadphase();
+				isRunning = false;
+			}
 
 			//improved delta time calculation from: https://gamedev.stackexchange.com/questions/110825/how-to-calculate-delta-time-with-sdl/123957
 			Uint64 NOW = SDL_GetPerformanceCounter();
 			Uint64 LAST = 0;
+			Uint64 START = NOW;
+			int frameCount = 0;
+			double accumulator = 0;
 
 			while (isRunning)
 			{
-				ProcessInput();
-				Update();
-				LAST = NOW;
-				NOW = SDL_GetPerformanceCounter();
-				deltaTime = (double)((NOW - LAST) * 100 / (double)SDL_GetPerformanceFrequency()); //modified to 100 from 1000 to make it milliseconds
-				Render();
-				ReleaseInputs();
+				profiler.BeginFrame();
+
+				if (fixedTimeStep)
+				{
+					LAST = NOW;
+					NOW = SDL_GetPerformanceCounter();
+					double frameTime = (double)((NOW - LAST) * 100 / (double)SDL_GetPerformanceFrequency());
+					double step = 100.0 / tickRate;
+
+					{
+						PROFILE_ZONE(profiler, "ProcessInput");
+						ProcessInput();
+						if (!RecordOrReplayInput(frameTime))
+							break;
+					}
+
+					//accumulate the elapsed time and consume it in constant steps, clamping it so a slow frame can't trigger an unbounded number of ticks
+					accumulator += frameTime;
+					if (accumulator > step * maxCatchUpTicks)
+						accumulator = step * maxCatchUpTicks;
+
+					while (accumulator >= step && isRunning)
+					{
+						PROFILE_ZONE(profiler, "Tick");
+						SavePreviousPositions();
+						deltaTime = step;
+						Update();
+						ReleaseInputs(); //a press is consumed by the first tick that sees it
+						accumulator -= step;
+					}
+
+					interpolationAlpha = accumulator / step;
+					Render();
+				}
+				else
+				{
+					{
+						PROFILE_ZONE(profiler, "ProcessInput");
+						ProcessInput();
+						if (!RecordOrReplayInput(deltaTime))
+							break;
+					}
+					Update();
+					LAST = NOW;
+					NOW = SDL_GetPerformanceCounter();
+					deltaTime = (double)((NOW - LAST) * 100 / (double)SDL_GetPerformanceFrequency()); //modified to 100 from 1000 to make it milliseconds
+					Render();
+					ReleaseInputs();
+				}
+
+				profiler.EndFrame();
+
+				frameCount++;
+				if (maxFrames > 0 && frameCount >= maxFrames)
+					isRunning = false;
 			}
 
+			//report the average frame cost, this is what soak tests are after when running headless
+			if (headless)
+			{
+				double seconds = (double)(SDL_GetPerformanceCounter() - START) / (double)SDL_GetPerformanceFrequency();
+				std::cout << "Simulated " << frameCount << " frames in " << seconds << "s, "
+					<< (frameCount > 0 ? seconds * 1000 / frameCount : 0) << "ms per frame" << std::endl;
+			}
+
+			inputRecorder.Close();
 			Terminate();
 		}
 		else
 		{
 			std::cout << "something is wrong" << std::endl;
-			system("PAUSE");
+			if (!headless)
+				system("PAUSE");
 		}
 	}
 
-	//adds an entity to the scene
+	//adds an entity to the scene right away, use SpawnEntity instead while iterating the scene
 	Entity* AddEntity(std::string name, float x, float y, SDL_Color col, int spriteindex)
 	{
-		Entity* ent = new Entity(name, x, y, col, spriteindex);
-		scene->push_back(ent);
-		return ent;
+		return AddEntity(entities->GetType(name.c_str()), x, y, col, spriteindex);
+	}
+
+	//adds an entity of an already known type to the scene right away, returns NULL if no more entities can exist
+	Entity* AddEntity(Uint16 type, float x, float y, SDL_Color col, int spriteindex)
+	{
+		EntityHandle handle = handles.Reserve();
+		if (handle == INVALID_ENTITY)
+		{
+			Log("Could not add entity, out of entity handles");
+			return NULL;
+		}
+		return CreateEntity(handle, type, x, y, col, spriteindex);
+	}
+
+	//requests a new entity, it is added to the scene after Update returns and its handle becomes valid then
+	//returns INVALID_ENTITY if no more entities can exist
+	EntityHandle SpawnEntity(Uint16 type, float x, float y, SDL_Color col, int spriteindex)
+	{
+		EntityHandle handle = handles.Reserve();
+		if (handle == INVALID_ENTITY)
+		{
+			Log("Could not spawn entity, out of entity handles");
+			return INVALID_ENTITY;
+		}
+		commands.Spawn(handle, type, x, y, col, spriteindex);
+		return handle;
+	}
+
+	//requests a new entity using the color and sprite of the prototype with the given name
+	EntityHandle SpawnEntity(const char* name, float x, float y)
+	{
+		Uint16 type = entities->GetType(name);
+		const EntityPrototype* proto = FindPrototype(type);
+		return SpawnEntity(type, x, y, proto ? proto->color : SDL_Color{ 0, 0, 0, 0 }, proto ? proto->spriteIndex : -1);
+	}
+
+	//requests the removal of an entity, it stays in the scene until Update returns
+	void DestroyEntity(EntityHandle handle)
+	{
+		commands.Destroy(handle);
+	}
+
+	//returns the entity a handle refers to, or NULL if that entity does not exist anymore
+	Entity* GetEntity(EntityHandle handle)
+	{
+		return handles.Get(handle);
+	}
+
+	//true if the handle refers to an entity that is still in the scene
+	bool IsValid(EntityHandle handle)
+	{
+		return handles.IsValid(handle);
 	}
 
 	//returns the first entity with a given name
-	Entity* FindEntity(std::string name)
+	Entity* FindEntity(const char* name)
 	{
-		for (Entity* e : *scene)
+		int type = entities->FindType(name);
+		if (type == -1)
+			return NULL;
+
+		return entities->FindFirst((Uint16)type);
+	}
+
+	Entity* FindEntity(const std::string& name)
+	{
+		return FindEntity(name.c_str());
+	}
+
+	//returns the first entity of a given type, types can be looked up once with GetEntityType
+	Entity* FindEntityOfType(Uint16 type)
+	{
+		return entities->FindFirst(type);
+	}
+
+	//COLLISION QUERIES, static entities are indexed when they are added, dynamic ones are refreshed after every Update
+	//every query writes up to capacity handles into out and returns how many it wrote, type -1 matches every entity type
+
+	//finds the entities containing a point
+	int QueryPoint(float x, float y, EntityHandle* out, int capacity, int type = -1)
+	{
+		return spatialHash.QueryPoint(x, y, out, capacity, type);
+	}
+
+	//finds the entities overlapping a box
+	int QueryAABB(const AABB& box, EntityHandle* out, int capacity, int type = -1)
+	{
+		return spatialHash.QueryAABB(box, out, capacity, type);
+	}
+
+	//finds the entities a box moving by dX, dY could hit
+	int QuerySweptAABB(const AABB& box, float dX, float dY, EntityHandle* out, int capacity, int type = -1)
+	{
+		return spatialHash.QuerySweptAABB(box, dX, dY, out, capacity, type);
+	}
+
+	//RAYCAST AND OVERLAP QUERIES, hits are written by increasing distance into the caller's buffer and nothing is allocated
+	//like the queries above they only read the broadphase, so worker threads can run them while the entities aren't being added, removed or synced
+
+	//casts a ray from x, y along the normalized direction dirX, dirY, entities containing x, y are not hit
+	int Raycast(float x, float y, float dirX, float dirY, float maxDistance, QueryHit* out, int capacity, int type = -1) const
+	{
+		return spatialHash.Raycast(x, y, dirX, dirY, maxDistance, out, capacity, type);
+	}
+
+	//finds the entities overlapping a box, closest to its center first
+	int OverlapBox(const AABB& box, QueryHit* out, int capacity, int type = -1) const
+	{
+		return spatialHash.OverlapBox(box, out, capacity, type);
+	}
+
+	//finds the entities overlapping a circle, closest to its center first
+	int OverlapCircle(float x, float y, float radius, QueryHit* out, int capacity, int type = -1) const
+	{
+		return spatialHash.OverlapCircle(x, y, radius, out, capacity, type);
+	}
+
+	//moves an entity by dX, dY, stopping against the entities of solidType and sliding along them with what is left of the move
+	//the time of impact is found with a swept test against the broadphase candidates, so fast movers don't tunnel through thin walls
+	//writes up to capacity contacts and returns how many it wrote, e.g. a contact with normalY < 0 means the entity landed on something
+	//dynamic solids are tested where they were at the last sync point, like every other broadphase query
+	int MoveAndSlide(EntityHandle handle, float dX, float dY, int solidType, MoveContact* contacts, int capacity)
+	{
+		Entity* ent = handles.Get(handle);
+		if (!ent)
+			return 0;
+
+		PROFILE_ZONE(profiler, "MoveAndSlide");
+		int found = 0;
+
+		//every step either completes the move or removes one axis from it, so two steps can't be exceeded in 2D, the third is a safety net
+		for (int step = 0; step < 3 && (dX != 0 || dY != 0); step++)
+		{
+			AABB box = ent->GetBounds();
+			//every solid in the path has to be tested, a long move through a crowded area must not drop the one actually hit
+			int count = QueryAll(box.Swept(dX, dY), slideCandidates, solidType);
+			const EntityHandle* candidates = slideCandidates.data();
+
+			//earliest hit among the candidates
+			EntityHandle hit = INVALID_ENTITY;
+			AABB hitBox = box;
+			float time = 1, normalX = 0, normalY = 0;
+			for (int i = 0; i < count; i++)
+			{
+				AABB other;
+				float t, nX, nY;
+				if (candidates[i] == handle || !spatialHash.GetBounds(candidates[i], other) || !box.Sweep(dX, dY, other, t, nX, nY) || t >= time)
+					continue;
+
+				hit = candidates[i];
+				hitBox = other;
+				time = t;
+				normalX = nX;
+				normalY = nY;
+			}
+
+			if (hit == INVALID_ENTITY)
+			{
+				ent->X() += dX;
+				ent->Y() += dY;
+				break;
+			}
+
+			//move up to the contact, placing the entity right against the face it hit so rounding can't leave the boxes overlapping
+			if (normalX != 0)
+			{
+				ent->X() = normalX < 0 ? hitBox.minX - (box.maxX - ent->X()) : hitBox.maxX + (ent->X() - box.minX);
+				ent->Y() += dY * time;
+			}
+			else
+			{
+				ent->Y() = normalY < 0 ? hitBox.minY - (box.maxY - ent->Y()) : hitBox.maxY + (ent->Y() - box.minY);
+				ent->X() += dX * time;
+			}
+
+			if (found < capacity)
+				contacts[found++] = { hit, normalX, normalY };
+
+			//slide along the face with the rest of the move
+			dX = normalX != 0 ? 0 : dX * (1 - time);
+			dY = normalY != 0 ? 0 : dY * (1 - time);
+		}
+		return found;
+	}
+
+	//resizes an entity, its box grows right and down from where it is drawn, see EntityBounds
+	void SetEntitySize(EntityHandle handle, float width, float height)
+	{
+		Entity* ent = handles.Get(handle);
+		if (!ent)
+			return;
+
+		SetTile(ent->slot, false);
+		entities->width[ent->slot] = width;
+		entities->height[ent->slot] = height;
+		SetTile(ent->slot, true);
+		PrepareSprite(ent->slot);
+
+		//static entities are never refreshed by the broadphase update, so every index learns the new size now
+		AABB box = ent->GetBounds();
+		spatialHash.Move(handle, box);
+		dynamicPairsDirty = true;
+		treeSelfPairs = -1;
+		if (entities->staticType[ent->GetType()])
 		{
-			if (e->name == name)
-				return e;
+			staticTree.Move(handle, box);
+			InvalidateStaticLayer();
 		}
-		return NULL;
+		else
+			dynamicTree.Move(handle, box);
+	}
+
+	//returns the pairs of overlapping dynamic entities where they were after the last Update, in no particular order
+	//they are only searched for when asked, once per frame at most, handles can be stale if an entity was destroyed since, check them with IsValid
+	const std::vector<EntityPair>& GetDynamicPairs()
+	{
+		if (dynamicPairsDirty)
+		{
+			PROFILE_ZONE(profiler, "DynamicPairs");
+			//DetectContacts already paired up the dynamic tree when contact pairs are registered
+			if (treeSelfPairs >= 0)
+				dynamicPairs.assign(treePairs.begin(), treePairs.begin() + treeSelfPairs);
+			else
+			{
+				dynamicPairs.clear();
+				dynamicTree.QuerySelfPairs(dynamicPairs);
+			}
+
+			//the tree pairs up fat boxes, only keep the entities that actually overlap
+			size_t kept = 0;
+			for (size_t i = 0; i < dynamicPairs.size(); i++)
+			{
+				AABB a, b;
+				if (spatialHash.GetBounds(dynamicPairs[i].a, a) && spatialHash.GetBounds(dynamicPairs[i].b, b) && a.Overlaps(b))
+					dynamicPairs[kept++] = dynamicPairs[i];
+			}
+			dynamicPairs.resize(kept);
+			dynamicPairsDirty = false;
+		}
+		return dynamicPairs;
+	}
+
+	//CONTACT EVENTS, the engine looks for overlaps between the registered type pairs once per frame, after the entities moved,
+	//and hands the begin, stay and end events of the frame to the next Update, so games don't need their own "test every entity" loops
+
+	//asks the engine to report the contacts between entities of the two named types, e.g. RegisterContactPair("Player", "Spikes")
+	void RegisterContactPair(const char* typeA, const char* typeB)
+	{
+		contacts.Register(entities->GetType(typeA), entities->GetType(typeB));
+	}
+
+	//returns the contact events of the frame, sorted by the handle of the first entity
+	const std::vector<ContactEvent>& GetContactEvents()
+	{
+		return contacts.events;
+	}
+
+	//TILE QUERIES, answered from the per type occupancy bits of static entities sitting on the level grid
+	//these are a few bit tests each, so a character controller can use them instead of looping over walls
+
+	//true if an entity of the given type sits on the tile containing the point
+	bool IsTileSolid(float x, float y, int type)
+	{
+		return type >= 0 && tileMap.IsSet(TileMap::TileOf(x), TileMap::TileOf(y), (Uint16)type);
+	}
+
+	//true if an entity of the given type sits on any tile overlapped by the box
+	bool IsAreaSolid(const AABB& box, int type)
+	{
+		if (type < 0)
+			return false;
+
+		int maxX = SDL_max(TileMap::TileOf(box.minX), (int)ceilf((box.maxX + ENTITYSIZE / 2) / ENTITYSIZE) - 1);
+		int maxY = SDL_max(TileMap::TileOf(box.minY), (int)ceilf((box.maxY + ENTITYSIZE / 2) / ENTITYSIZE) - 1);
+		return tileMap.AnySet(TileMap::TileOf(box.minX), TileMap::TileOf(box.minY), maxX, maxY, (Uint16)type);
+	}
+
+	//walks the row at height y from fromX to toX and finds the first tile holding an entity of the given type, hitX is that entity's x
+	bool FirstSolidTileX(float y, float fromX, float toX, int type, float& hitX)
+	{
+		int hit;
+		if (type < 0 || !tileMap.FirstInRow(TileMap::TileOf(y), TileMap::TileOf(fromX), TileMap::TileOf(toX), (Uint16)type, hit))
+			return false;
+
+		hitX = (float)(hit * ENTITYSIZE);
+		return true;
+	}
+
+	//walks the column at x from fromY to toY and finds the first tile holding an entity of the given type, hitY is that entity's y
+	bool FirstSolidTileY(float x, float fromY, float toY, int type, float& hitY)
+	{
+		int hit;
+		if (type < 0 || !tileMap.FirstInColumn(TileMap::TileOf(x), TileMap::TileOf(fromY), TileMap::TileOf(toY), (Uint16)type, hit))
+			return false;
+
+		hitY = (float)(hit * ENTITYSIZE);
+		return true;
+	}
+
+	//returns the entities of a given type, use this instead of walking the whole scene when a system only cares about one kind of entity
+	EntitySpan GetEntitiesOfType(Uint16 type)
+	{
+		return entities->OfType(type);
+	}
+
+	EntitySpan GetEntitiesOfType(const char* name)
+	{
+		int type = entities->FindType(name);
+		if (type == -1)
+			return EntitySpan(NULL, 0, NULL);
+		return entities->OfType((Uint16)type);
+	}
+
+	//returns the type ID of the entities with the given name, or -1 if there is no such entity type
+	int GetEntityType(const char* name)
+	{
+		return entities->FindType(name);
 	}
 
 	//sets the sprite of a given entity
-	void SetSpriteForEntity(std::string Name, int index)
+	void SetSpriteForEntity(const char* Name, int index)
 	{
+		int type = entities->FindType(Name);
+		if (type == -1)
+			return;
+
 		//change in the DB
-		for (Entity* e : *entityesDB)
+		for (EntityPrototype& proto : *entityesDB)
 		{
-			if (e->name == Name)
-				e->SetSprite(index);
+			if (proto.type == type)
+				proto.spriteIndex = index;
 		}
 
 		//change in the scene
-		for (Entity* e : *scene)
+		for (Uint32 slot : entities->slotsByType[type])
 		{
-			if (e->name == Name)
-				e->SetSprite(index);
+			entities->spriteIndex[slot] = index;
+			PrepareSprite(slot);
 		}
+
+		if (entities->staticType[type])
+			InvalidateStaticLayer();
+	}
+
+	void SetSpriteForEntity(const std::string& Name, int index)
+	{
+		SetSpriteForEntity(Name.c_str(), index);
+	}
+
+	//redraws the background and the static entities before the next frame, the engine does it whenever a static entity is added, removed,
+	//resized or changes sprite, call it after changing a static entity's color or position directly
+	void InvalidateStaticLayer()
+	{
+		staticLayerDirty = true;
 	}
 
 	//exits the core engine loop
@@ -136,15 +600,24 @@ public:
 		isRunning = false;
 	}
 
-	//loads the next level in the resources folder
+	//loads the next level in the resources folder, when called from Update the level is loaded once Update returns
 	void LoadNextLevel()
 	{
+		if (updating)
+		{
+			pendingLevel = NEXT_LEVEL;
+			return;
+		}
+
+		PROFILE_ZONE(profiler, "LoadLevel");
+
 		//check if level exists
 		std::string fName = "resources/L" + std::to_string(currentLevel) + ".bmp";
 		std::ifstream f(fName.c_str());
 		if (f.good())
 		{
 			//std::cout << "Loading " << fName << std::endl;
+			SDL_FreeSurface(currentLevelSurface);
 			currentLevelSurface = IMG_Load(fName.c_str());
 			currentLevel++;
 		}
@@ -154,43 +627,28 @@ public:
 			isRunning = false;
 			return;
 		}
-		//we gucci, clear scene
-		scene->clear();
+		//we gucci, build the scene from it
+		BuildScene();
+	}
 
-		//if it does, let's generate a level from it!
-		for (int i = 0; i < currentLevelSurface->w; i++)
+	//loads a specific level, when called from Update the level is loaded once Update returns
+	void LoadLevel(int index)
+	{
+		if (updating)
 		{
-			for (int j = 0; j < currentLevelSurface->h; j++)
-			{
-				//get the pixel color and pass it to the cached ones
-				Uint8 red, green, blue;
-				SDL_GetRGB(getpixel(currentLevelSurface, i, j), currentLevelSurface->format, &red, &green, &blue);
-
-				//look in the database for a matching entity and add it to the SceneGraph
-				for (Entity* ent : *entityesDB)
-				{
-					if (ent->color.r == red && ent->color.g == green && ent->color.b == blue)
-					{
-						AddEntity(ent->name, i * ENTITYSIZE, j * ENTITYSIZE, { red, green, blue }, ent->spriteIndex);
-						//std::cout << "Added entity " << ent->name << std::endl;
-					}
-				}
-			}
+			pendingLevel = index;
+			return;
 		}
 
-		//call Start
-		startMethod(this);
-	}
+		PROFILE_ZONE(profiler, "LoadLevel");
 
-	//loads a specific level
-	void LoadLevel(int index)
-	{
 		//check if level exists
 		std::string fName = "resources/L" + std::to_string(index) + ".bmp";
 		std::ifstream f(fName.c_str());
 		if (f.good())
 		{
 			//std::cout << "Loading " << fName << std::endl;
+			SDL_FreeSurface(currentLevelSurface);
 			currentLevelSurface = IMG_Load(fName.c_str());
 		}
 		else //if it doesn't exist, we completed all the levels
@@ -199,10 +657,118 @@ public:
 			isRunning = false;
 			return;
 		}
-		//we gucci, clear scene
-		scene->clear();
+		//we gucci, build the scene from it
+		BuildScene();
+	}
+
+	//returns the currently loaded level number
+	int GetCurrentLevel()
+	{
+		return currentLevel;
+	}
+
+	//plays the given sound
+	void PlaySound(int index)
+	{
+		//there is no audio device when running headless
+		if (headless)
+			return;
+
+		if (Mix_PlayChannel(-1, audioClips->at(index), 0) == -1)
+			Log("Could not play sound :(");
+	}
+
+	//logs a text message to the screen
+	void Log(std::string msg)
+	{
+		std::cout << msg << std::endl;
+	}
+
+private:
+	//The window we'll be rendering to
+	SDL_Window* window = NULL;
+
+	//The surface contained by the window
+	SDL_Surface* screenSurface = NULL;
+	SDL_Surface* background = NULL;
+	SDL_Surface* staticLayer = NULL; //background with the static entities drawn on it
+	bool staticLayerDirty = true;
+	int bakedX = 0, bakedY = 0; //world position of the static layer's top left corner
+	int lastViewX = 0, lastViewY = 0; //camera view of the last frame
+	std::vector<EntityHandle> culledHandles; //spatial hash results of the view culling
+	std::vector<EntityHandle> slideCandidates; //spatial hash results of MoveAndSlide
+	std::vector<Uint32> visibleSlots; //dynamic entities in view this frame
+	std::vector<Uint32> bakedSlots; //static entities in the baked area
+	DirtyRectTracker dirtyRects; //screen regions dynamic entities were drawn in
+
+	//RENDER_SDL backend, the surfaces above are still used to load and bake, the results are uploaded as textures
+	SDL_Renderer* renderer = NULL;
+	std::vector<SDL_Texture*> spriteTextures; //one per atlas page
+	SDL_Texture* staticTexture = NULL; //the static layer
+	RenderBatch renderBatch;
+
+	//font
+	TTF_Font *font = 0;
+
+	//gameplay stuff
+	bool isRunning = false;
+	bool updating = false; //true while the Update callback runs
+	callbackType startMethod;
+	callbackType updateMethod;
+
+	//levels
+	int currentLevel = 0;
+	SDL_Surface* currentLevelSurface = NULL;
+	EntityArena entityArena; //storage of the current level's entity views
+	HandleTable handles;
+	EntityCommandBuffer commands; //spawns and destroys requested since the last sync point
+	SpatialHash spatialHash; //broadphase of every entity in the scene
+	std::vector<EntityPair> dynamicPairs; //overlapping dynamic entities, found by GetDynamicPairs
+	bool dynamicPairsDirty = true; //the dynamic entities moved since dynamicPairs was found
+	ContactTracker contacts; //contacts between the registered type pairs
+	DynamicTree staticTree; //bounding volume hierarchies of the static and dynamic entities, the collision phase pairs them up
+	DynamicTree dynamicTree = DynamicTree(DYNAMICTREE_MARGIN);
+	std::vector<EntityPair> treePairs; //candidate pairs found in the trees by the collision phase
+	int treeSelfPairs = -1; //how many of treePairs, at their start, are the dynamic tree's own pairs, -1 if they weren't looked for since the entities moved
+	std::vector<std::vector<ContactEvent>> chunkContacts; //contacts found by each narrowphase task
+	WorkerPool workers;
+	TileMap tileMap; //occupancy of the level grid by static entities
+	int pendingLevel = NO_LEVEL; //level requested during Update
+
+	//delta time calculation
+	float lastTime;
+
+	//input recording
+	InputRecorder inputRecorder;
+	bool recording = false;
+	bool replaying = false;
 
-		//if it does, let's generate a level from it!
+
+	//clears the scene and fills it with the entities described by the pixels of the current level surface, then calls Start
+	void BuildScene()
+	{
+		//clear scene, this releases all the entities of the previous level in one go and invalidates their handles
+		ApplyCommands(); //so handles reserved by pending spawns are released too
+		for (Entity* e : *scene)
+			handles.Release(e->ID);
+		entities->Clear();
+		entityArena.Reset();
+		spatialHash.Clear(currentLevelSurface->w * currentLevelSurface->h / 4);
+		dynamicPairsDirty = true;
+		staticTree.Clear();
+		dynamicTree.Clear();
+		contacts.Reset();
+		tileMap.Reset(currentLevelSurface->w, currentLevelSurface->h);
+		InvalidateStaticLayer();
+
+		//the camera starts at the level's top left corner with nothing to follow
+		camera.worldWidth = (float)currentLevelSurface->w * ENTITYSIZE;
+		camera.worldHeight = (float)currentLevelSurface->h * ENTITYSIZE;
+		camera.target = INVALID_ENTITY;
+		camera.x = 0;
+		camera.y = 0;
+
+		//generate a level from the bitmap!
 		for (int i = 0; i < currentLevelSurface->w; i++)
 		{
 			for (int j = 0; j < currentLevelSurface->h; j++)
@@ -212,62 +778,199 @@ public:
 				SDL_GetRGB(getpixel(currentLevelSurface, i, j), currentLevelSurface->format, &red, &green, &blue);
 
 				//look in the database for a matching entity and add it to the SceneGraph
-				for (Entity* ent : *entityesDB)
+				for (EntityPrototype& proto : *entityesDB)
 				{
-					if (ent->color.r == red && ent->color.g == green && ent->color.b == blue)
+					if (proto.color.r == red && proto.color.g == green && proto.color.b == blue)
 					{
-						AddEntity(ent->name, i * ENTITYSIZE, j * ENTITYSIZE, { red, green, blue }, ent->spriteIndex);
-						//std::cout << "Added entity " << ent->name << std::endl;
+						AddEntity(proto.type, i * ENTITYSIZE, j * ENTITYSIZE, { red, green, blue }, proto.spriteIndex);
+						//std::cout << "Added entity " << proto.name << std::endl;
 					}
 				}
 			}
 		}
 
 		//call Start
-		startMethod(this);
+		{
+			PROFILE_ZONE(profiler, "UserStart");
+			startMethod(this);
+		}
+		ApplyCommands();
+		UpdateBroadphase();
+		DetectContacts();
 	}
 
-	//returns the currently loaded level number
-	int GetCurrentLevel()
+	//creates an entity in the store and binds it to a reserved handle
+	Entity* CreateEntity(EntityHandle handle, Uint16 type, float x, float y, SDL_Color col, int spriteindex)
 	{
-		return currentLevel;
+		//entities take the extents of their prototype
+		const EntityPrototype* proto = FindPrototype(type);
+		float width = proto ? proto->width : ENTITYSIZE, height = proto ? proto->height : ENTITYSIZE;
+
+		Entity* ent = entityArena.Allocate(entities, entities->Count());
+		entities->Add(type, x, y, width, height, col, spriteindex, ent);
+		ent->ID = handle;
+		handles.Bind(handle, ent);
+		PrepareSprite(ent->slot);
+
+		AABB box = EntityBounds(x, y, width, height);
+		spatialHash.Insert(handle, type, box);
+		if (entities->staticType[type])
+			staticTree.Insert(handle, box);
+		else
+			dynamicTree.Insert(handle, box);
+		SetTile(ent->slot, true);
+		if (entities->staticType[type])
+			InvalidateStaticLayer();
+		return ent;
 	}
 
-	//plays the given sound
-	void PlaySound(int index)
+	//removes an entity from the store, its view goes back to the arena for later spawns
+	void RemoveEntity(EntityHandle handle)
 	{
-		if (Mix_PlayChannel(-1, audioClips->at(index), 0) == -1)
-			Log("Could not play sound :(");
+		Entity* ent = handles.Get(handle);
+		if (!ent)
+			return;
+
+		spatialHash.Remove(handle);
+		staticTree.Remove(handle);
+		dynamicTree.Remove(handle);
+		SetTile(ent->slot, false);
+		if (entities->staticType[ent->GetType()])
+			InvalidateStaticLayer();
+		Entity* moved = entities->Remove(ent->slot);
+		if (moved)
+			moved->slot = ent->slot;
+		handles.Release(handle);
+		entityArena.Release(ent);
+	}
+
+	//applies the buffered spawns and destroys in the order they were requested, this is the engine's sync point
+	void ApplyCommands()
+	{
+		if (commands.Empty())
+			return;
+
+		PROFILE_ZONE(profiler, "ApplyCommands");
+		for (const EntityCommand& command : commands.commands)
+		{
+			if (command.kind == ENTITYCOMMAND_SPAWN)
+				CreateEntity(command.handle, command.type, command.x, command.y, command.color, command.spriteIndex);
+			else
+				RemoveEntity(command.handle);
+		}
+		commands.Clear();
+	}
+
+	//marks the tile under a static entity as occupied or free, entities that are off the level grid or don't fill exactly one tile are ignored
+	void SetTile(Uint32 slot, bool occupied)
+	{
+		Uint16 type = entities->type[slot];
+		float x = entities->x[slot], y = entities->y[slot];
+		if (!entities->staticType[type] || entities->width[slot] != ENTITYSIZE || entities->height[slot] != ENTITYSIZE)
+			return;
+
+		int tileX = TileMap::TileOf(x), tileY = TileMap::TileOf(y);
+		if (tileX * ENTITYSIZE == x && tileY * ENTITYSIZE == y)
+			tileMap.Set(tileX, tileY, type, occupied);
+	}
+
+	//moves the dynamic entities to their current cells in the spatial hash, static ones were placed once when they were added
+	//the dynamic pairs are found again the next time they are asked for
+	void UpdateBroadphase()
+	{
+		PROFILE_ZONE(profiler, "UpdateBroadphase");
+		for (size_t type = 0; type < entities->slotsByType.size(); type++)
+		{
+			if (entities->staticType[type])
+				continue;
+
+			for (Uint32 slot : entities->slotsByType[type])
+			{
+				AABB box = EntityBounds(entities->x[slot], entities->y[slot], entities->width[slot], entities->height[slot]);
+				spatialHash.Move(entities->views[slot]->ID, box);
+				dynamicTree.Move(entities->views[slot]->ID, box); //only reinserted once it leaves its fat box
+			}
+		}
+		dynamicPairsDirty = true;
+		treeSelfPairs = -1;
 	}
 
-	//logs a text message to the screen
-	void Log(std::string msg)
+	//collision phase, finds the overlaps between the registered type pairs and turns them into this frame's contact events
+	//candidates come from pairing up the trees, dynamic against dynamic and against static, so entities of any size are handled alike
+	void DetectContacts()
 	{
-		std::cout << msg << std::endl;
-	}
+		PROFILE_ZONE(profiler, "DetectContacts");
+		treePairs.clear();
+		treeSelfPairs = -1;
+		if (!contacts.pairs.empty())
+		{
+			dynamicTree.QuerySelfPairs(treePairs);
+			treeSelfPairs = (int)treePairs.size();
+			dynamicTree.QueryPairs(staticTree, treePairs);
 
-private:
-	//The window we'll be rendering to
-	SDL_Window* window = NULL;
+			//static entities never move into each other, but a pair of static types can still be registered
+			for (const ContactTracker::TypePair& pair : contacts.pairs)
+			{
+				if (entities->staticType[pair.a] && entities->staticType[pair.b])
+				{
+					staticTree.QuerySelfPairs(treePairs);
+					break;
+				}
+			}
+		}
 
-	//The surface contained by the window
-	SDL_Surface* screenSurface = NULL;
-	SDL_Surface* background = NULL;
+		//narrowphase, the candidates are split in fixed size chunks spread over the workers, then merged back in chunk order
+		int chunks = (int)((treePairs.size() + CONTACT_CHUNK - 1) / CONTACT_CHUNK);
+		if (chunkContacts.size() < (size_t)chunks)
+			chunkContacts.resize(chunks);
+		workers.ParallelFor(chunks, [this](int chunk) { Narrowphase(chunk); });
 
-	//font
-	TTF_Font *font = 0;
+		for (int chunk = 0; chunk < chunks; chunk++)
+		{
+			for (const ContactEvent& contact : chunkContacts[chunk])
+				contacts.Add(contact.a, contact.b, contact.typeA, contact.typeB);
+		}
+		contacts.Finish();
+	}
 
-	//gameplay stuff
-	bool isRunning = false;
-	callbackType startMethod;
-	callbackType updateMethod;
+	//tests one chunk of the candidate pairs, it only reads the scene and writes the chunk's own buffer so chunks can run on any thread
+	void Narrowphase(int chunk)
+	{
+		PROFILE_ZONE(profiler, "Narrowphase");
+		std::vector<ContactEvent>& found = chunkContacts[chunk];
+		found.clear();
 
-	//levels
-	int currentLevel = 0;
-	SDL_Surface* currentLevelSurface = NULL;
+		size_t end = SDL_min((size_t)(chunk + 1) * CONTACT_CHUNK, treePairs.size());
+		for (size_t i = (size_t)chunk * CONTACT_CHUNK; i < end; i++)
+		{
+			//the trees hold fat boxes, the exact test uses the entities' own
+			const EntityPair& candidate = treePairs[i];
+			Entity* first = handles.Get(candidate.a);
+			Entity* second = handles.Get(candidate.b);
+			if (!first || !second || !first->GetBounds().Overlaps(second->GetBounds()))
+				continue;
+
+			Uint16 firstType = first->GetType(), secondType = second->GetType();
+			for (const ContactTracker::TypePair& pair : contacts.pairs)
+			{
+				if (pair.a == firstType && pair.b == secondType)
+					found.push_back({ CONTACT_STAY, candidate.a, candidate.b, firstType, secondType });
+				else if (pair.a == secondType && pair.b == firstType)
+					found.push_back({ CONTACT_STAY, candidate.b, candidate.a, secondType, firstType });
+			}
+		}
+	}
 
-	//delta time calculation
-	float lastTime;
+	//returns the prototype entities of the given type are built from, or NULL if the type was not read from Entities.txt
+	const EntityPrototype* FindPrototype(Uint16 type)
+	{
+		for (const EntityPrototype& proto : *entityesDB)
+		{
+			if (proto.type == type)
+				return &proto;
+		}
+		return NULL;
+	}
 
 
 	//RESOURCES CACHING------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -275,7 +978,7 @@ private:
 	//loads the background
 	bool LoadBackGround()
 	{
-		background = IMG_Load("resources/background.png");
+		background = PrepareSurface(IMG_Load("resources/background.png"), 0, 0, false);
 
 		if (!background)
 			return false;
@@ -295,34 +998,190 @@ private:
 	}
 
 	//loads all the sprites present in the resources folder, they have to be in the bmp format
+	//the sprites are packed in the atlas, or read back from the atlas cache when it was packed from the same files
 	void CacheSprites()
 	{
-		int currentSprite = 0;
+		//find the sprites, a hash of their contents tells a cached atlas whether it is still up to date
+		std::vector<std::string> files;
+		std::vector<Uint64> fingerprints;
 		bool finished = false;
 		while (!finished)
 		{
 			//check if sprite exists
-			std::string fName = "resources/S" + std::to_string(currentSprite) + ".bmp";
-			std::ifstream f(fName.c_str());
-			if (f.good())
+			std::string fName = "resources/S" + std::to_string(files.size()) + ".bmp";
+			Uint64 fingerprint;
+			if (SpriteAtlas::Fingerprint(fName, fingerprint))
 			{
-				//std::cout << "Loading " << fName << std::endl;
-
-				//load image in memory
-				SDL_Surface *img = IMG_Load(fName.c_str());
-				//set 255,0,255 as our transparent color
-				SDL_SetColorKey(img, SDL_TRUE, SDL_MapRGB(screenSurface->format, 255, 0, 255));
-				//add to the database
-				sprites->push_back(img);
-				currentSprite++;
+				files.push_back(fName);
+				fingerprints.push_back(fingerprint);
 			}
-			else //if it doesn't exist, we completed all the levels
+			else //if it doesn't exist, we found all the sprites
 			{
 				Log("Could not find sprites in the resources folder");
 				finished = true;
 			}
 		}
-		std::cout << "Finished loading sprites, found: " << sprites->size() << std::endl;
+
+		if (!atlasCachePath.empty() && spriteAtlas.Load(atlasCachePath, fingerprints, screenSurface->format))
+		{
+			std::cout << "Finished loading sprites from the atlas cache, found: " << spriteAtlas.Count() << std::endl;
+			return;
+		}
+		//a stale or broken cache is deleted, it is written again below
+		if (!atlasCachePath.empty())
+			SpriteAtlas::Remove(atlasCachePath);
+
+		//load images in memory, already in the screen's format and size with 255,0,255 as our transparent color
+		std::vector<SDL_Surface*> images;
+		for (const std::string& fName : files)
+		{
+			SDL_Surface *img = PrepareSurface(IMG_Load(fName.c_str()), ENTITYSIZE, ENTITYSIZE, true);
+			if (img)
+				images.push_back(img);
+		}
+
+		if (images.size() != files.size() || !spriteAtlas.Build(images))
+			Log("Could not pack the sprites :(");
+		else if (!atlasCachePath.empty() && !spriteAtlas.Save(atlasCachePath, fingerprints))
+			Log("Could not save the sprite atlas");
+
+		for (SDL_Surface* img : images)
+			SDL_FreeSurface(img);
+		std::cout << "Finished loading sprites, found: " << spriteAtlas.Count() << " packed in " << spriteAtlas.pages.size() << " atlas pages" << std::endl;
+	}
+
+	//converts a freshly loaded image to the screen's pixel format and scales it to width x height (0 keeps its size), the original is freed
+	//color keyed surfaces are RLE encoded, so drawing them every frame is a plain blit that skips the transparent runs
+	SDL_Surface* PrepareSurface(SDL_Surface* img, int width, int height, bool colorKey)
+	{
+		if (!img)
+			return NULL;
+
+		SDL_Surface* converted = SDL_ConvertSurface(img, screenSurface->format, 0);
+		SDL_FreeSurface(img);
+		if (!converted)
+			return NULL;
+
+		if (width > 0 && height > 0 && (converted->w != width || converted->h != height))
+		{
+			SDL_Surface* scaled = SDL_CreateRGBSurfaceWithFormat(0, width, height, converted->format->BitsPerPixel, converted->format->format);
+			if (scaled)
+			{
+				//copy the pixels as they are, the key color must survive the scale
+				SDL_SetSurfaceBlendMode(converted, SDL_BLENDMODE_NONE);
+				SDL_BlitScaled(converted, NULL, scaled, NULL);
+				SDL_FreeSurface(converted);
+				converted = scaled;
+			}
+		}
+
+		if (colorKey)
+		{
+			SDL_SetColorKey(converted, SDL_TRUE, SDL_MapRGB(converted->format, 255, 0, 255));
+			SDL_SetSurfaceRLE(converted, 1);
+		}
+		return converted;
+	}
+
+	//times drawing every sprite the way Render used to (loaded as is, scaled on every blit) against the prepared sprites, and logs both
+	//run with --headless --bench-blit on the machine to compare, the last line sums up every sprite
+	void BenchmarkBlits()
+	{
+		const int repeats = 1000;
+		double totalBefore = 0, totalAfter = 0;
+		for (size_t i = 0; i < spriteAtlas.Count(); i++)
+		{
+			std::string fName = "resources/S" + std::to_string(i) + ".bmp";
+			SDL_Surface* raw = IMG_Load(fName.c_str());
+			if (!raw)
+				continue;
+			SDL_SetColorKey(raw, SDL_TRUE, SDL_MapRGB(raw->format, 255, 0, 255));
+
+			Uint64 start = SDL_GetPerformanceCounter();
+			for (int r = 0; r < repeats; r++)
+			{
+				SDL_Rect rect{ (r * ENTITYSIZE) % (SCREEN_WIDTH - ENTITYSIZE), 0, ENTITYSIZE, ENTITYSIZE };
+				SDL_BlitScaled(raw, 0, screenSurface, &rect);
+			}
+			Uint64 middle = SDL_GetPerformanceCounter();
+			for (int r = 0; r < repeats; r++)
+			{
+				SDL_Rect rect{ (r * ENTITYSIZE) % (SCREEN_WIDTH - ENTITYSIZE), 0, ENTITYSIZE, ENTITYSIZE };
+				spriteAtlas.Blit((int)i, screenSurface, &rect);
+			}
+			Uint64 end = SDL_GetPerformanceCounter();
+			SDL_FreeSurface(raw);
+
+			double frequency = (double)SDL_GetPerformanceFrequency();
+			double before = (middle - start) * 1000000 / frequency / repeats;
+			double after = (end - middle) * 1000000 / frequency / repeats;
+			std::cout << fName << ": " << before << "us per scaled blit, " << after << "us per prepared blit, " << before / after << "x" << std::endl;
+			totalBefore += before;
+			totalAfter += after;
+		}
+		if (totalAfter > 0)
+			std::cout << "all sprites: " << totalBefore << "us scaled, " << totalAfter << "us prepared, " << totalBefore / totalAfter << "x" << std::endl;
+		else
+			Log("No sprites were timed");
+	}
+
+	//times sweep and prune against the dynamic tree, which the engine uses, at finding the dynamic pairs frame after frame and logs both:
+	//the dynamic entities of the current scene sway around their place by up to a tile and a half, so both pay for keeping up with motion,
+	//the insertion sort of sweep and prune and the reinsertions of the tree, as they would in a game
+	void BenchmarkBroadphase()
+	{
+		const int frames = 1000;
+		std::vector<AABB> start;
+		for (size_t type = 0; type < entities->slotsByType.size(); type++)
+		{
+			if (entities->staticType[type])
+				continue;
+			for (Uint32 slot : entities->slotsByType[type])
+				start.push_back(entities->views[slot]->GetBounds());
+		}
+
+		//the entities' indices stand in for their handles
+		SweepAndPrune sweepAndPrune;
+		DynamicTree tree(DYNAMICTREE_MARGIN);
+		for (size_t i = 0; i < start.size(); i++)
+		{
+			sweepAndPrune.Insert((EntityHandle)i, start[i]);
+			tree.Insert((EntityHandle)i, start[i]);
+		}
+
+		std::vector<AABB> boxes(start.size());
+		std::vector<EntityPair> pairs;
+		size_t sweepPairs = 0, treePairCount = 0;
+		double sweepTime = 0, treeTime = 0, frequency = (double)SDL_GetPerformanceFrequency();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			for (size_t i = 0; i < boxes.size(); i++)
+			{
+				float dX = ENTITYSIZE * 1.5f * sinf(frame * 0.05f + i), dY = ENTITYSIZE * 1.5f * cosf(frame * 0.03f + i * 0.7f);
+				boxes[i] = { start[i].minX + dX, start[i].minY + dY, start[i].maxX + dX, start[i].maxY + dY };
+			}
+
+			Uint64 begin = SDL_GetPerformanceCounter();
+			for (size_t i = 0; i < boxes.size(); i++)
+				sweepAndPrune.Move((EntityHandle)i, boxes[i]);
+			sweepAndPrune.FindPairs(pairs);
+			sweepPairs += pairs.size();
+			Uint64 middle = SDL_GetPerformanceCounter();
+
+			for (size_t i = 0; i < boxes.size(); i++)
+				tree.Move((EntityHandle)i, boxes[i]);
+			pairs.clear();
+			tree.QuerySelfPairs(pairs);
+			for (const EntityPair& pair : pairs)
+				treePairCount += boxes[pair.a].Overlaps(boxes[pair.b]) ? 1 : 0;
+			Uint64 end = SDL_GetPerformanceCounter();
+
+			sweepTime += (middle - begin) / frequency;
+			treeTime += (end - middle) / frequency;
+		}
+
+		std::cout << start.size() << " dynamic entities, " << frames << " frames: sweep and prune " << sweepTime * 1000000 / frames << "us per frame for " <<
+			sweepPairs << " pairs, dynamic tree " << treeTime * 1000000 / frames << "us per frame for " << treePairCount << " pairs" << std::endl;
 	}
 
 	//loads all the audio clips present in the resources folder, they have to be in the wav format
@@ -358,7 +1217,7 @@ private:
 	void PopulateEntityDatabase()
 	{
 		//init db
-		entityesDB = new std::vector<Entity*>();
+		entityesDB = new std::vector<EntityPrototype>();
 		//read Entities file
 		std::string line;
 		std::ifstream myfile("resources/Entities.txt");
@@ -368,10 +1227,28 @@ private:
 			{
 				//populate database
 				std::vector<std::string> entityDescriptor = split(line.c_str(), ' ');
-				//an entity is described in the file as: R G B NAME, we build the database from that format
-				entityesDB->push_back(new Entity(entityDescriptor[3], //Name
-					SDL_Color({ (Uint8)stoi(entityDescriptor[0]), (Uint8)stoi(entityDescriptor[1]), (Uint8)stoi(entityDescriptor[2]) }) //color
-					, stoi(entityDescriptor[4]))); //sprite index
+				//an entity is described in the file as: R G B NAME SPRITE [static] [size W H], we build the database from that format
+				EntityPrototype proto;
+				proto.name = entityDescriptor[3];
+				proto.color = SDL_Color({ (Uint8)stoi(entityDescriptor[0]), (Uint8)stoi(entityDescriptor[1]), (Uint8)stoi(entityDescriptor[2]) });
+				proto.spriteIndex = stoi(entityDescriptor[4]);
+				proto.type = entities->GetType(proto.name.c_str()); //names are interned once here, lookups by name only hash afterwards
+				proto.isStatic = false;
+				proto.width = ENTITYSIZE;
+				proto.height = ENTITYSIZE;
+				for (size_t i = 5; i < entityDescriptor.size(); i++)
+				{
+					if (entityDescriptor[i] == "static")
+						proto.isStatic = true;
+					else if (entityDescriptor[i] == "size" && i + 2 < entityDescriptor.size())
+					{
+						proto.width = (float)stoi(entityDescriptor[i + 1]);
+						proto.height = (float)stoi(entityDescriptor[i + 2]);
+						i += 2;
+					}
+				}
+				entities->staticType[proto.type] = proto.isStatic;
+				entityesDB->push_back(proto);
 			}
 			std::cout << "Entities database filled with " << entityesDB->size() << " Entities" << std::endl;
 			myfile.close();
@@ -398,8 +1275,11 @@ private:
 		PopulateEntityDatabase();
 
 		CacheSprites();
+		if (renderer)
+			UploadSpriteTextures();
 
-		CacheAudioClips();
+		if (!headless)
+			CacheAudioClips();
 		
 		LoadNextLevel();
 	}
@@ -410,31 +1290,84 @@ private:
 	//creates the SDL window, initializes audio and the various data vectors
 	bool Init()
 	{
-		//Initialize SDL
-		if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+		//Initialize SDL, a headless run only needs the event queue
+		if (SDL_Init(headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
 		{
 			std::cout << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
 			return false;
 		}
 		else
 		{
-			//Create window
-			window = SDL_CreateWindow("SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-			if (window == NULL)
+			if (headless)
 			{
-				std::cout << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
-				return false;
+				//render into an offscreen surface instead of a window
+				screenSurface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGB888);
+				if (screenSurface == NULL)
+				{
+					std::cout << "Offscreen surface could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+					return false;
+				}
+
+				//the software renderer draws into the offscreen surface, it needs no GPU and no window
+				if (renderBackend == RENDER_SDL)
+				{
+					renderer = SDL_CreateSoftwareRenderer(screenSurface);
+					if (renderer == NULL)
+					{
+						std::cout << "Software renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+						return false;
+					}
+				}
+
+				//Initialize fonts
+				TTF_Init();
 			}
 			else
 			{
-				//Get window surface
-				screenSurface = SDL_GetWindowSurface(window);
+				//Create window
+				window = SDL_CreateWindow("SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+				if (window == NULL)
+				{
+					std::cout << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+					return false;
+				}
 
-				//Fill the surface white
-				SDL_FillRect(screenSurface, NULL, SDL_MapRGB(screenSurface->format, 0xFF, 0xFF, 0xFF));
+				if (renderBackend == RENDER_SDL)
+				{
+					//first renderer that works, SDL tries the accelerated ones before the software one
+					renderer = SDL_CreateRenderer(window, -1, 0);
+					if (renderer == NULL)
+					{
+						std::cout << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+						return false;
+					}
+					SDL_RendererInfo info;
+					if (SDL_GetRendererInfo(renderer, &info) == 0)
+						std::cout << "Rendering with " << info.name << std::endl;
 
-				//Update the surface
-				SDL_UpdateWindowSurface(window);
+					//a window with a renderer can't use its surface, sprites are loaded and the static layer baked in an offscreen one
+					screenSurface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+					if (screenSurface == NULL)
+					{
+						std::cout << "Offscreen surface could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+						return false;
+					}
+
+					SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+					SDL_RenderClear(renderer);
+					SDL_RenderPresent(renderer);
+				}
+				else
+				{
+					//Get window surface
+					screenSurface = SDL_GetWindowSurface(window);
+
+					//Fill the surface white
+					SDL_FillRect(screenSurface, NULL, SDL_MapRGB(screenSurface->format, 0xFF, 0xFF, 0xFF));
+
+					//Update the surface
+					SDL_UpdateWindowSurface(window);
+				}
 
 				//Initialize fonts
 				TTF_Init();
@@ -453,34 +1386,53 @@ private:
 						return false;
 					}
 				}
+			}
 
-				//init clips vector
-				audioClips = new std::vector<Mix_Chunk*>();
+			//the camera shows a window sized part of the level
+			camera.width = SCREEN_WIDTH;
+			camera.height = SCREEN_HEIGHT;
 
-				//init scene vector
-				scene = new std::vector<Entity*>();
+			//init clips vector
+			audioClips = new std::vector<Mix_Chunk*>();
 
-				//init sprites vector
-				sprites = new std::vector<SDL_Surface*>();
+			//init the entity store, the scene is its list of views
+			entities = new EntityStore();
+			scene = &entities->views;
 
-				return true;
-			}
+			//start the collision workers
+			workers.Start(workerThreads > 0 ? workerThreads : SDL_GetCPUCount());
+
+			return true;
 		}
 	}
 
 	//frees all the cached resources and deletes the vectors in memory
 	void Terminate()
 	{
-		//Destroy window
-		SDL_DestroyWindow(window);
+		workers.Stop();
+
+		//free textures, before the renderer that owns them
+		for (SDL_Texture* texture : spriteTextures)
+			SDL_DestroyTexture(texture);
+		spriteTextures.clear();
+		if (staticTexture)
+			SDL_DestroyTexture(staticTexture);
+		staticTexture = NULL;
+		if (renderer)
+			SDL_DestroyRenderer(renderer);
+
+		//Destroy window, the offscreen surface of a headless run or of the renderer backend is ours to free
+		if (headless || renderBackend == RENDER_SDL)
+			SDL_FreeSurface(screenSurface);
+		if (!headless)
+			SDL_DestroyWindow(window);
 
 		//free surfaces
 		SDL_FreeSurface(background);
+		SDL_FreeSurface(staticLayer);
+		SDL_FreeSurface(currentLevelSurface);
 
-		for (SDL_Surface *surf : *sprites)
-		{
-			SDL_FreeSurface(surf);
-		}
+		spriteAtlas.Clear();
 
 		//free font
 		if (font)
@@ -495,57 +1447,329 @@ private:
 
 		//Quit SDL subsystems
 		SDL_Quit();
-		Mix_CloseAudio();
+		if (!headless)
+			Mix_CloseAudio();
 
 		//clear pointers
-		delete scene;
+		delete entities;
 		delete entityesDB;
-		delete sprites;
+
+		//export the profiled frames
+		if (!traceExportPath.empty())
+		{
+			if (profiler.ExportChromeTrace(traceExportPath))
+				std::cout << "Profiler trace written to " << traceExportPath << std::endl;
+			else
+				std::cout << "Could not write profiler trace to " << traceExportPath << std::endl;
+		}
 
 		std::cout << "Game terminated" << std::endl;
-		system("PAUSE");
+		if (!headless)
+			system("PAUSE");
 	}
 
 
 	//MAIN ENGINE METHODS
 
-	//renders the background
-	void RenderBackground()
+	//draws the background and the static entities around the view into the static layer, Render copies the view's part of it to the screen
+	//until it is invalidated or the camera scrolls out of it, only the static entities in the baked area are drawn so huge levels bake as fast as small ones
+	void BakeStaticLayer(int viewX, int viewY)
+	{
+		PROFILE_ZONE(profiler, "BakeStaticLayer");
+		if (!staticLayer)
+		{
+			staticLayer = SDL_CreateRGBSurfaceWithFormat(0, camera.width + 2 * STATICLAYER_MARGIN, camera.height + 2 * STATICLAYER_MARGIN,
+				screenSurface->format->BitsPerPixel, screenSurface->format->format);
+			if (!staticLayer)
+				return;
+			SDL_SetSurfaceBlendMode(staticLayer, SDL_BLENDMODE_NONE); //the copy to the screen is a plain memory copy
+		}
+		bakedX = viewX - STATICLAYER_MARGIN;
+		bakedY = viewY - STATICLAYER_MARGIN;
+
+		//draw background, it repeats across levels larger than it
+		if (background)
+		{
+			int startX = (int)floorf((float)bakedX / background->w) * background->w;
+			int startY = (int)floorf((float)bakedY / background->h) * background->h;
+			for (int y = startY; y < bakedY + staticLayer->h; y += background->h)
+			{
+				for (int x = startX; x < bakedX + staticLayer->w; x += background->w)
+				{
+					SDL_Rect destination = { x - bakedX, y - bakedY, 0, 0 };
+					SDL_BlitSurface(background, 0, staticLayer, &destination);
+				}
+			}
+		}
+		else
+			SDL_FillRect(staticLayer, NULL, SDL_MapRGB(staticLayer->format, 0, 0, 0));
+
+		CullEntities({ bakedX, bakedY, staticLayer->w, staticLayer->h }, true, bakedSlots);
+		for (Uint32 slot : bakedSlots)
+			DrawEntity(staticLayer, slot, (int)entities->x[slot] - bakedX, (int)entities->y[slot] - bakedY);
+		staticLayerDirty = false;
+	}
+
+	//finds the static or the dynamic entities drawn in a world rectangle, in the order of the full draw loop over slotsByType
+	//(by type, then by position in the type's list) so they overlap the way they did before culling
+	void CullEntities(const SDL_Rect& area, bool staticEntities, std::vector<Uint32>& slots)
+	{
+		PROFILE_ZONE(profiler, "CullEntities");
+		//entities are drawn ENTITYSIZE / 2 right and down of their collision box
+		AABB box = { (float)area.x - ENTITYSIZE / 2, (float)area.y - ENTITYSIZE / 2,
+			(float)(area.x + area.w) - ENTITYSIZE / 2, (float)(area.y + area.h) - ENTITYSIZE / 2 };
+
+		int found = QueryAll(box, culledHandles);
+
+		slots.clear();
+		for (int i = 0; i < found; i++)
+		{
+			Entity* ent = handles.Get(culledHandles[i]);
+			if (ent && entities->staticType[entities->type[ent->slot]] == staticEntities)
+				slots.push_back(ent->slot);
+		}
+
+		const EntityStore& s = *entities;
+		std::sort(slots.begin(), slots.end(), [&s](Uint32 a, Uint32 b)
+		{
+			return s.type[a] != s.type[b] ? s.type[a] < s.type[b] : s.typeIndex[a] < s.typeIndex[b];
+		});
+	}
+
+	//finds every entity overlapping a box, out grows until it holds them all, returns how many were found
+	int QueryAll(const AABB& box, std::vector<EntityHandle>& out, int type = -1)
+	{
+		if (out.size() < (size_t)QUERY_CANDIDATES)
+			out.resize(QUERY_CANDIDATES);
+		int found;
+		while ((found = spatialHash.QueryAABB(box, out.data(), (int)out.size(), type)) == (int)out.size())
+			out.resize(out.size() * 2);
+		return found;
+	}
+
+	//centers the camera on its target where the target is drawn this frame, then keeps it inside the level
+	void UpdateCamera()
+	{
+		Entity* target = camera.target != INVALID_ENTITY ? handles.Get(camera.target) : NULL;
+		if (target)
+			camera.CenterOn(InterpolatedX(target->slot) + entities->width[target->slot] / 2, InterpolatedY(target->slot) + entities->height[target->slot] / 2);
+		camera.Clamp();
+	}
+
+	//moves the camera, bakes the static layer again if it is invalid or the view left it, and finds the dynamic entities in view
+	void PrepareFrame(bool& rebaked, bool& scrolled)
+	{
+		UpdateCamera();
+		int viewX = camera.ViewX(), viewY = camera.ViewY();
+
+		rebaked = staticLayerDirty || !staticLayer || viewX < bakedX || viewY < bakedY ||
+			viewX + camera.width > bakedX + staticLayer->w || viewY + camera.height > bakedY + staticLayer->h;
+		if (rebaked)
+			BakeStaticLayer(viewX, viewY);
+
+		scrolled = viewX != lastViewX || viewY != lastViewY;
+		lastViewX = viewX;
+		lastViewY = viewY;
+
+		//the spatial hash has the entities where they are after the last tick, they are drawn up to a tick behind so look a tile further
+		CullEntities({ viewX - ENTITYSIZE, viewY - ENTITYSIZE, camera.width + 2 * ENTITYSIZE, camera.height + 2 * ENTITYSIZE }, false, visibleSlots);
+	}
+
+	//scales a copy of an entity's sprite to its size ahead of drawing it, if it isn't ENTITYSIZE
+	void PrepareSprite(Uint32 slot)
 	{
-		//draw background
-		SDL_BlitSurface(background, 0, screenSurface, 0);
+		spriteAtlas.PrepareScaled(entities->spriteIndex[slot], (int)entities->width[slot], (int)entities->height[slot]);
 	}
 
-	//renders all the entities on screen after rendering the background
+	//draws one entity at the given position
+	void DrawEntity(SDL_Surface* target, Uint32 slot, int x, int y)
+	{
+		const EntityStore& s = *entities;
+
+		//if entity has a sprite, we draw it, sprites are stored at ENTITYSIZE and entities of other sizes draw a copy scaled to their size
+		if (s.spriteIndex[slot] != -1)
+		{
+			SDL_Rect rect{ x, y, (int)s.width[slot], (int)s.height[slot] };
+			spriteAtlas.Blit(s.spriteIndex[slot], target, &rect);
+		}
+		//if the entity has no sprite attached to it, render a square
+		else
+		{
+			const SDL_Rect Rect = { x, y, (int)s.width[slot], (int)s.height[slot] };
+			Uint32 col = SDL_MapRGB(target->format, s.color[slot].r, s.color[slot].g, s.color[slot].b);
+			SDL_FillRect(target, &Rect, col);
+		}
+	}
+
+	//renders the static layer, then the dynamic entities in view on top of it
+	//only the regions the dynamic entities covered last frame or cover now are restored and presented, unless too much of the screen changed
 	void Render()
 	{
-		RenderBackground();
+		PROFILE_ZONE(profiler, "Render");
+		if (renderer)
+		{
+			RenderBatched();
+			return;
+		}
+		const EntityStore& s = *entities;
+
+		//a scroll changes the whole screen
+		bool rebaked, scrolled;
+		PrepareFrame(rebaked, scrolled);
+		if (rebaked || scrolled)
+			dirtyRects.RequestFullRedraw();
+		int viewX = lastViewX, viewY = lastViewY;
+		int layerX = viewX - bakedX, layerY = viewY - bakedY; //where the view is in the static layer
+
+		//find where the dynamic entities are drawn this frame
+		dirtyRects.BeginFrame(screenSurface->w, screenSurface->h);
+		for (Uint32 i : visibleSlots)
+			dirtyRects.AddDrawn({ InterpolatedX(i) - viewX, InterpolatedY(i) - viewY, (int)s.width[i], (int)s.height[i] });
+		bool partial = dirtyRects.Resolve(dirtyRectThreshold);
 
-		for (Entity* e : *scene)
 		{
-			//if entity has a sprite, we draw it
-			if (e->spriteIndex != -1)
+			PROFILE_ZONE(profiler, "RenderStaticLayer");
+			if (partial)
+			{
+				//erase by copying back the static layer under the dirty regions only
+				for (const SDL_Rect& rect : dirtyRects.dirty)
+				{
+					SDL_Rect source = { rect.x + layerX, rect.y + layerY, rect.w, rect.h }, destination = rect;
+					SDL_BlitSurface(staticLayer, &source, screenSurface, &destination);
+				}
+			}
+			else
+			{
+				SDL_Rect source = { layerX, layerY, screenSurface->w, screenSurface->h };
+				SDL_BlitSurface(staticLayer, &source, screenSurface, 0);
+			}
+		}
+
+		{
+			PROFILE_ZONE(profiler, "RenderEntities");
+			//walk the store's arrays directly, Render never needs the Entity views
+			for (Uint32 i : visibleSlots)
+				DrawEntity(screenSurface, i, InterpolatedX(i) - viewX, InterpolatedY(i) - viewY);
+		}
+
+		//update screen, headless runs have nothing to present
+		if (!headless)
+		{
+			PROFILE_ZONE(profiler, "Present");
+			if (partial)
 			{
-				SDL_Rect rect{ e->x, e->y, ENTITYSIZE, ENTITYSIZE };
-				SDL_BlitScaled(sprites->at(e->spriteIndex), 0, screenSurface, &rect);
+				if (!dirtyRects.dirty.empty())
+					SDL_UpdateWindowSurfaceRects(window, dirtyRects.dirty.data(), (int)dirtyRects.dirty.size());
 			}
-			//if the entity has no sprite attached to it, render a square
 			else
+				SDL_UpdateWindowSurface(window);
+		}
+	}
+
+	//renders the same frame as Render through the SDL_Renderer: the static layer as one texture, then the dynamic entities as a sorted batch
+	//the renderer redraws the whole frame every time, so the dirty rectangles aren't used
+	void RenderBatched()
+	{
+		const EntityStore& s = *entities;
+
+		bool rebaked, scrolled;
+		PrepareFrame(rebaked, scrolled);
+		int viewX = lastViewX, viewY = lastViewY;
+		if (rebaked || !staticTexture)
+		{
+			if (staticTexture)
+				SDL_DestroyTexture(staticTexture);
+			staticTexture = staticLayer ? SDL_CreateTextureFromSurface(renderer, staticLayer) : NULL;
+		}
+
+		{
+			PROFILE_ZONE(profiler, "RenderBatch");
+			//entity types are the layers, so entities overlap like they do when blitted type by type
+			renderBatch.Clear();
+			for (Uint32 i : visibleSlots)
 			{
-				const SDL_Rect Rect = { e->x, e->y, ENTITYSIZE, ENTITYSIZE }; //our entities will always be 32 by 32
-				Uint32 col = SDL_MapRGB(screenSurface->format, e->color.r, e->color.g, e->color.b);
-				SDL_FillRect(screenSurface, &Rect, col);
+				SDL_Rect rect{ InterpolatedX(i) - viewX, InterpolatedY(i) - viewY, (int)s.width[i], (int)s.height[i] };
+				int sprite = s.spriteIndex[i];
+				if (sprite >= 0 && (size_t)sprite < spriteAtlas.Count())
+					renderBatch.AddSprite(s.type[i], spriteAtlas.regions[sprite].page, spriteAtlas.regions[sprite].rect, rect);
+				else
+					renderBatch.AddFill(s.type[i], rect, { s.color[i].r, s.color[i].g, s.color[i].b, 255 });
 			}
 		}
 
-		//update screen
-		SDL_UpdateWindowSurface(window);
+		{
+			PROFILE_ZONE(profiler, "RenderStaticLayer");
+			SDL_Rect source = { viewX - bakedX, viewY - bakedY, camera.width, camera.height };
+			if (staticTexture)
+				SDL_RenderCopy(renderer, staticTexture, &source, NULL);
+		}
+
+		{
+			PROFILE_ZONE(profiler, "RenderEntities");
+			renderBatch.Submit(renderer, spriteTextures);
+		}
+
+		//the software renderer of a headless run has drawn into the offscreen surface already
+		{
+			PROFILE_ZONE(profiler, "Present");
+			SDL_RenderPresent(renderer);
+		}
+	}
+
+	//uploads the atlas pages as the textures RenderBatched draws the sprites from
+	void UploadSpriteTextures()
+	{
+		for (SDL_Texture* texture : spriteTextures)
+			SDL_DestroyTexture(texture);
+		spriteTextures.clear();
+
+		//the pages' color key becomes transparent alpha in the textures
+		for (SDL_Surface* page : spriteAtlas.pages)
+		{
+			SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, page);
+			if (!texture)
+				Log("Could not upload an atlas page :(");
+			spriteTextures.push_back(texture);
+		}
+	}
+
+	//position an entity is drawn at, interpolated between the last two ticks, with a variable timestep alpha is always 1
+	int InterpolatedX(Uint32 slot)
+	{
+		return (int)(entities->prevX[slot] + (entities->x[slot] - entities->prevX[slot]) * interpolationAlpha);
+	}
+
+	int InterpolatedY(Uint32 slot)
+	{
+		return (int)(entities->prevY[slot] + (entities->y[slot] - entities->prevY[slot]) * interpolationAlpha);
+	}
+
+	//stores the current position of every entity so Render can interpolate from it
+	void SavePreviousPositions()
+	{
+		entities->prevX = entities->x;
+		entities->prevY = entities->y;
 	}
 
 	//calls the external Update method by using function pointers
 	void Update()
 	{
+		PROFILE_ZONE(profiler, "Update");
+		updating = true;
 		updateMethod(this);
+		updating = false;
+
+		//sync point: buffered spawns and destroys are applied and the broadphase catches up with the entities that moved
+		ApplyCommands();
+		UpdateBroadphase();
+		DetectContacts();
+
+		//the callback can't see its entities being destroyed while it runs, level changes it asked for happen here
+		if (pendingLevel == NEXT_LEVEL)
+			LoadNextLevel();
+		else if (pendingLevel != NO_LEVEL)
+			LoadLevel(pendingLevel);
+		pendingLevel = NO_LEVEL;
 	}
 
 	//handles SDL events and sets the input states in the relative input arrays
@@ -562,6 +1786,11 @@ private:
 		{
 			isRunning = false;
 		}
+		//the window was shown, exposed or restored, present all of it again
+		else if (e.type == SDL_WINDOWEVENT)
+		{
+			dirtyRects.RequestFullRedraw();
+		}
 	//User presses a key
 		else if (e.type == SDL_KEYDOWN)
 		{
@@ -619,6 +1848,42 @@ private:
 		}
 	}
 
+	//opens the recording or the replay requested through recordPath and replayPath, a replay takes precedence
+	void OpenInputRecording()
+	{
+		if (!replayPath.empty())
+		{
+			replaying = inputRecorder.OpenForReplay(replayPath);
+			if (!replaying)
+				Log("Could not open input replay " + replayPath);
+		}
+		else if (!recordPath.empty())
+		{
+			recording = inputRecorder.OpenForRecording(recordPath);
+			if (!recording)
+				Log("Could not create input recording " + recordPath);
+		}
+	}
+
+	//overwrites this frame's input and delta time with the recorded ones when replaying, or records them, returns false when the replay is over
+	bool RecordOrReplayInput(double& frameDelta)
+	{
+		if (replaying)
+		{
+			if (!inputRecorder.ReadFrame(inputHeld, inputPressed, frameDelta))
+			{
+				Log("Replay finished");
+				isRunning = false;
+				return false;
+			}
+		}
+		else if (recording)
+		{
+			inputRecorder.WriteFrame(inputHeld, inputPressed, frameDelta);
+		}
+		return true;
+	}
+
 	//releases inputs, this is useful for determining if a key is pressed or held
 	void ReleaseInputs()
 	{
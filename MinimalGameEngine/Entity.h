@@ -1,76 +1,121 @@
 #pragma once
 #include <SDL/SDL.h>
 #include <string>
+#include "EntityStore.h"
+#include "EntityHandles.h"
+#include "AABB.h"
+#include "CollisionKernels.h"
 
 static const int ENTITYSIZE = 32;
 
+//collision box of an entity at the given position, entities are ENTITYSIZE wide and centered on their position for collision purposes
+inline AABB EntityBounds(float x, float y)
+{
+	return { x - ENTITYSIZE / 2, y - ENTITYSIZE / 2, x + ENTITYSIZE / 2, y + ENTITYSIZE / 2 };
+}
+
+//collision box of an entity with the given extents, it keeps the same offset from the drawn rectangle as an ENTITYSIZE box
+//so an entity grows right and down from where it is drawn
+inline AABB EntityBounds(float x, float y, float width, float height)
+{
+	return { x - ENTITYSIZE / 2, y - ENTITYSIZE / 2, x - ENTITYSIZE / 2 + width, y - ENTITYSIZE / 2 + height };
+}
+
+//describes a kind of entity as read from the Entities.txt file, levels are built by matching pixel colors against these
+struct EntityPrototype
+{
+	std::string name;
+	SDL_Color color;
+	int spriteIndex;
+	Uint16 type; //type given to the entities created from this prototype
+	bool isStatic; //static entities never move, e.g. walls
+	float width, height; //extents of the entities created from this prototype
+};
+
+//view of a single entity living in the EntityStore, the data itself is stored in the store's arrays
 class Entity
 {
 public:
-	Entity(std::string Name, float X, float Y, SDL_Color col, int sprIndex)
+	Entity(EntityStore* entityStore, Uint32 entitySlot)
 	{
-		name = Name;
-		x = X;
-		y = Y;
-		color = col;
-		spriteIndex = sprIndex;
+		store = entityStore;
+		slot = entitySlot;
 	}
 
-	Entity(std::string Name, float X, float Y, SDL_Color col)
+public:
+	EntityStore* store;
+	Uint32 slot;
+	EntityHandle ID = INVALID_ENTITY; //handle issued by the engine when the entity is added to the scene
+
+
+	//properties
+
+	float& X()
 	{
-		name = Name;
-		x = X;
-		y = Y;
-		color = col;
-		spriteIndex = -1;
+		return store->x[slot];
 	}
-	
-	Entity(std::string Name, float X, float Y, int sprIndex)
+
+	float& Y()
 	{
-		name = Name;
-		x = X;
-		y = Y;
-		color = *(new SDL_Color());
-		spriteIndex = sprIndex;
+		return store->y[slot];
 	}
 
-	Entity(std::string Name, SDL_Color col, int sprIndex)
+	const std::string& GetName()
 	{
-		name = Name;
-		color = col;
-		spriteIndex = sprIndex;
+		return store->typeNames.Get(store->type[slot]);
 	}
 
-	~Entity();
+	Uint16 GetType()
+	{
+		return store->type[slot];
+	}
 
-public:
-	std::string name = "";
-	float x = 0, y = 0;
-	SDL_Color color = *(new SDL_Color());
-	int spriteIndex = -1;
-	Uint16 ID = -1;
+	SDL_Color GetColor()
+	{
+		return store->color[slot];
+	}
 
+	int GetSprite()
+	{
+		return store->spriteIndex[slot];
+	}
 
-	//properties
+	float GetWidth()
+	{
+		return store->width[slot];
+	}
+
+	float GetHeight()
+	{
+		return store->height[slot];
+	}
+
+	AABB GetBounds()
+	{
+		return EntityBounds(X(), Y(), GetWidth(), GetHeight());
+	}
 
 	void SetColor(Uint8 r, Uint8 g, Uint8 b)
 	{
-		color = { r, g, b };
+		store->color[slot] = { r, g, b };
 	}
 
 	void SetSprite(int index)
 	{
-		spriteIndex = index;
+		store->spriteIndex[slot] = index;
 	}
 
 	//collision
 
+	//compatibility layer: these tests treat both entities as ENTITYSIZE boxes whatever their extents, like they always did
+	//use GetBounds().Overlaps or the engine's queries to test entities of other sizes
+
 	bool TestCollision(float dX, float dY, Entity* collider) //AABB swept collision sprite check
 	{
-		if (x + dX + ENTITYSIZE/2 - 3 > collider->x - ENTITYSIZE/2 &&
-			x + dX - ENTITYSIZE/2 + 3 < collider->x + ENTITYSIZE/2 && //x is inside
-			y + dY + ENTITYSIZE/2 > collider->y - ENTITYSIZE/2 &&
-			y + dY - ENTITYSIZE/2 < collider->y + ENTITYSIZE/2) //y is inside
+		if (X() + dX + ENTITYSIZE/2 - 3 > collider->X() - ENTITYSIZE/2 &&
+			X() + dX - ENTITYSIZE/2 + 3 < collider->X() + ENTITYSIZE/2 && //x is inside
+			Y() + dY + ENTITYSIZE/2 > collider->Y() - ENTITYSIZE/2 &&
+			Y() + dY - ENTITYSIZE/2 < collider->Y() + ENTITYSIZE/2) //y is inside
 			return true;
 		else
 			return false;
@@ -78,10 +123,10 @@ public:
 
 	bool TestCollisionBox(float X, float Y, float width, float height, Entity* collider) //AABB swept collision box check
 	{
-		if (X + width > collider->x - ENTITYSIZE / 2 &&
-			X - width < collider->x + ENTITYSIZE / 2 && //x is inside
-			Y + height > collider->y - ENTITYSIZE / 2 &&
-			Y - height < collider->y + ENTITYSIZE / 2) //y is inside
+		if (X + width > collider->X() - ENTITYSIZE / 2 &&
+			X - width < collider->X() + ENTITYSIZE / 2 && //x is inside
+			Y + height > collider->Y() - ENTITYSIZE / 2 &&
+			Y - height < collider->Y() + ENTITYSIZE / 2) //y is inside
 			return true;
 		else
 			return false;
@@ -89,15 +134,32 @@ public:
 
 	bool TestCollisionPoint(float X, float Y, Entity* collider)
 	{
-		if (x + X > collider->x - ENTITYSIZE / 2 &&
-			x + X < collider->x + ENTITYSIZE / 2 && //x is inside
-			y + Y > collider->y - ENTITYSIZE / 2 &&
-			y + Y < collider->y + ENTITYSIZE / 2) //y is inside
+		if (this->X() + X > collider->X() - ENTITYSIZE / 2 &&
+			this->X() + X < collider->X() + ENTITYSIZE / 2 && //x is inside
+			this->Y() + Y > collider->Y() - ENTITYSIZE / 2 &&
+			this->Y() + Y < collider->Y() + ENTITYSIZE / 2) //y is inside
 			return true;
 		else
 			return false;
 	}
+
+	//batched versions of the tests above, the collider is any candidate at xs[i], ys[i] (e.g. the store's x and y arrays)
+	//the index of every candidate hit is written to hits, which needs room for count indices, and the number of hits is returned
+
+	int TestCollisionBatch(float dX, float dY, const float* xs, const float* ys, int count, Uint32* hits)
+	{
+		return BatchTestRange(X() + dX - ENTITYSIZE + 3, X() + dX + ENTITYSIZE - 3, Y() + dY - ENTITYSIZE, Y() + dY + ENTITYSIZE, xs, ys, count, hits);
+	}
+
+	int TestCollisionBoxBatch(float X, float Y, float width, float height, const float* xs, const float* ys, int count, Uint32* hits)
+	{
+		return BatchTestRange(X - width - ENTITYSIZE / 2, X + width + ENTITYSIZE / 2, Y - height - ENTITYSIZE / 2, Y + height + ENTITYSIZE / 2, xs, ys, count, hits);
+	}
+
+	int TestCollisionPointBatch(float X, float Y, const float* xs, const float* ys, int count, Uint32* hits)
+	{
+		return BatchTestRange(this->X() + X - ENTITYSIZE / 2, this->X() + X + ENTITYSIZE / 2, this->Y() + Y - ENTITYSIZE / 2, this->Y() + Y + ENTITYSIZE / 2, xs, ys, count, hits);
+	}
 private:
 
 };
-
@@ -0,0 +1,72 @@
+#pragma once
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "Entity.h"
+
+static const int ENTITYARENA_BLOCKSIZE = 4096; //entities per block
+
+static_assert(std::is_trivially_destructible<Entity>::value, "the arena releases entities without running their destructors");
+
+//level scoped storage for the Entity views: entities are carved out of fixed size blocks that are kept for the whole run
+//and rewound in one go when a level unloads, so after the biggest level has been loaded once, level transitions don't allocate
+//entities destroyed during a level go to a free list that later allocations reuse
+class EntityArena
+{
+public:
+	EntityArena()
+	{
+	}
+
+	~EntityArena()
+	{
+		for (Entity* block : blocks)
+			::operator delete(block);
+	}
+
+	EntityArena(const EntityArena&) = delete;
+	EntityArena& operator=(const EntityArena&) = delete;
+
+public:
+	//constructs an entity in the arena, growing it by a block if all the current ones are in use
+	Entity* Allocate(EntityStore* store, Uint32 slot)
+	{
+		if (!freeList.empty())
+		{
+			Entity* recycled = freeList.back();
+			freeList.pop_back();
+			return new (recycled) Entity(store, slot);
+		}
+
+		if (used == blocks.size() * ENTITYARENA_BLOCKSIZE)
+			blocks.push_back((Entity*)::operator new(sizeof(Entity) * ENTITYARENA_BLOCKSIZE));
+
+		Entity* memory = blocks[used / ENTITYARENA_BLOCKSIZE] + used % ENTITYARENA_BLOCKSIZE;
+		used++;
+		return new (memory) Entity(store, slot);
+	}
+
+	//gives a single entity back to the arena so the next Allocate can reuse it
+	void Release(Entity* entity)
+	{
+		freeList.push_back(entity);
+	}
+
+	//releases every entity at once, the blocks are kept for the next level
+	void Reset()
+	{
+		used = 0;
+		freeList.clear();
+	}
+
+	//number of entities currently allocated
+	size_t Count() const
+	{
+		return used - freeList.size();
+	}
+
+private:
+	std::vector<Entity*> blocks;
+	std::vector<Entity*> freeList;
+	size_t used = 0;
+};
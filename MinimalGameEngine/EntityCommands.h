@@ -0,0 +1,47 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <vector>
+#include "EntityHandles.h"
+
+static const Uint8 ENTITYCOMMAND_SPAWN = 0;
+static const Uint8 ENTITYCOMMAND_DESTROY = 1;
+
+//a spawn or destroy request, spawn requests carry everything needed to build the entity
+struct EntityCommand
+{
+	Uint8 kind;
+	EntityHandle handle;
+	Uint16 type;
+	float x, y;
+	SDL_Color color;
+	int spriteIndex;
+};
+
+//records the spawn and destroy requests made during a frame, the engine applies them in order at its sync point after Update
+class EntityCommandBuffer
+{
+public:
+	void Spawn(EntityHandle handle, Uint16 type, float x, float y, SDL_Color col, int sprIndex)
+	{
+		commands.push_back({ ENTITYCOMMAND_SPAWN, handle, type, x, y, col, sprIndex });
+	}
+
+	void Destroy(EntityHandle handle)
+	{
+		commands.push_back({ ENTITYCOMMAND_DESTROY, handle, 0, 0, 0, { 0, 0, 0, 0 }, -1 });
+	}
+
+	//empties the buffer, its memory is kept for the next frame
+	void Clear()
+	{
+		commands.clear();
+	}
+
+	bool Empty() const
+	{
+		return commands.empty();
+	}
+
+public:
+	std::vector<EntityCommand> commands;
+};
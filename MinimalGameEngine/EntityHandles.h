@@ -0,0 +1,92 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <deque>
+#include <vector>
+
+class Entity; //forward declaration needed for the table entries
+
+//32 bit reference to an entity: the low bits index the handle table, the high bits hold the generation of that index
+//once the entity is destroyed the generation moves on, so stale handles are detected instead of dangling
+typedef Uint32 EntityHandle;
+
+static const int ENTITYHANDLE_INDEXBITS = 20;
+static const Uint32 ENTITYHANDLE_INDEXMASK = (1u << ENTITYHANDLE_INDEXBITS) - 1;
+static const Uint32 ENTITYHANDLE_GENERATIONMASK = (1u << (32 - ENTITYHANDLE_INDEXBITS)) - 1;
+static const EntityHandle INVALID_ENTITY = 0xFFFFFFFF;
+
+//released indices wait in line until this many are free, so an index is only reused after at least as many other releases
+static const size_t ENTITYHANDLE_MINFREE = 1024;
+
+//issues handles and maps them back to entities in O(1), indices of released handles are reused oldest first
+//an index whose generation would wrap is retired instead, so a stale handle can never become valid again
+class HandleTable
+{
+public:
+	//returns a new handle referring to the given entity, or INVALID_ENTITY if every index is in use
+	EntityHandle Issue(Entity* entity)
+	{
+		Uint32 index;
+		if (freeIndices.size() > ENTITYHANDLE_MINFREE || (!freeIndices.empty() && entries.size() >= ENTITYHANDLE_INDEXMASK))
+		{
+			index = freeIndices.front();
+			freeIndices.pop_front();
+		}
+		else
+		{
+			//the last index is never issued so no handle can be equal to INVALID_ENTITY
+			index = (Uint32)entries.size();
+			if (index >= ENTITYHANDLE_INDEXMASK)
+				return INVALID_ENTITY;
+			entries.push_back(NULL);
+			generations.push_back(0);
+		}
+
+		entries[index] = entity;
+		return (generations[index] << ENTITYHANDLE_INDEXBITS) | index;
+	}
+
+	//returns a handle that doesn't refer to anything yet, it becomes valid once Bind is called on it
+	EntityHandle Reserve()
+	{
+		return Issue(NULL);
+	}
+
+	//attaches an entity to a handle returned by Reserve
+	void Bind(EntityHandle handle, Entity* entity)
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		if (index < entries.size() && generations[index] == handle >> ENTITYHANDLE_INDEXBITS)
+			entries[index] = entity;
+	}
+
+	//invalidates a handle, its index will be reused by a later Issue
+	void Release(EntityHandle handle)
+	{
+		if (!IsValid(handle))
+			return;
+
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		entries[index] = NULL;
+		generations[index] = (generations[index] + 1) & ENTITYHANDLE_GENERATIONMASK;
+		if (generations[index] != 0) //wrapped around, the index is retired
+			freeIndices.push_back(index);
+	}
+
+	//true if the handle still refers to a live entity
+	bool IsValid(EntityHandle handle) const
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		return index < entries.size() && entries[index] != NULL && generations[index] == handle >> ENTITYHANDLE_INDEXBITS;
+	}
+
+	//returns the entity the handle refers to, or NULL if it has been destroyed
+	Entity* Get(EntityHandle handle) const
+	{
+		return IsValid(handle) ? entries[handle & ENTITYHANDLE_INDEXMASK] : NULL;
+	}
+
+private:
+	std::vector<Entity*> entries;
+	std::vector<Uint16> generations;
+	std::deque<Uint32> freeIndices;
+};
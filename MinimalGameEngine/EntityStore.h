@@ -0,0 +1,183 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <string>
+#include <vector>
+#include "NameTable.h"
+
+class Entity; //forward declaration needed for the views
+
+//contiguous range of entity slots, iterating it yields the Entity views while slots gives direct access to the store's arrays
+class EntitySpan
+{
+public:
+	class Iterator
+	{
+	public:
+		Iterator(const Uint32* s, Entity* const* v) : slot(s), views(v) {}
+		Entity* operator*() const { return views[*slot]; }
+		Iterator& operator++() { slot++; return *this; }
+		bool operator!=(const Iterator& other) const { return slot != other.slot; }
+
+	private:
+		const Uint32* slot;
+		Entity* const* views;
+	};
+
+	EntitySpan(const Uint32* s, Uint32 n, Entity* const* v) : slots(s), count(n), views(v) {}
+
+	Iterator begin() const { return Iterator(slots, views); }
+	Iterator end() const { return Iterator(slots + count, views); }
+	Uint32 size() const { return count; }
+	bool empty() const { return count == 0; }
+	Entity* operator[](Uint32 i) const { return views[slots[i]]; }
+
+public:
+	const Uint32* slots;
+	Uint32 count;
+
+private:
+	Entity* const* views;
+};
+
+//dense structure of arrays holding the data the engine touches every frame, slot i of every array belongs to the same entity
+//hot loops (rendering, collision) should walk these arrays directly instead of going through the Entity views
+class EntityStore
+{
+public:
+	//per entity data
+	std::vector<float> x, y;
+	std::vector<float> prevX, prevY; //position at the previous fixed tick, used for render interpolation
+	std::vector<float> width, height; //extents of the entity, ENTITYSIZE unless its prototype or SetEntitySize says otherwise
+	std::vector<int> spriteIndex;
+	std::vector<SDL_Color> color;
+	std::vector<Uint16> type; //index in typeNames
+	std::vector<Entity*> views; //compatibility view of each slot, for code written against Entity
+
+	//type names, interned to the IDs stored in type
+	NameTable typeNames;
+
+	//slots of the entities of each type, indexed by type
+	std::vector<std::vector<Uint32>> slotsByType;
+	std::vector<Uint32> typeIndex; //position of each slot in its slotsByType list
+	std::vector<bool> staticType; //indexed by type, entities of a static type never move
+
+	//number of entities in the store
+	Uint32 Count() const
+	{
+		return (Uint32)x.size();
+	}
+
+	//appends an entity and returns its slot
+	Uint32 Add(Uint16 entityType, float X, float Y, float W, float H, SDL_Color col, int sprIndex, Entity* view)
+	{
+		x.push_back(X);
+		y.push_back(Y);
+		prevX.push_back(X);
+		prevY.push_back(Y);
+		width.push_back(W);
+		height.push_back(H);
+		spriteIndex.push_back(sprIndex);
+		color.push_back(col);
+		type.push_back(entityType);
+		views.push_back(view);
+		typeIndex.push_back((Uint32)slotsByType[entityType].size());
+		slotsByType[entityType].push_back(Count() - 1);
+		return Count() - 1;
+	}
+
+	//removes the entity in the given slot by moving the last entity into it, returns the view of the moved entity or NULL if none was moved
+	Entity* Remove(Uint32 slot)
+	{
+		//take the entity out of its type list, the last entity of that list fills the gap
+		std::vector<Uint32>& bucket = slotsByType[type[slot]];
+		Uint32 lastOfType = bucket.back();
+		bucket[typeIndex[slot]] = lastOfType;
+		typeIndex[lastOfType] = typeIndex[slot];
+		bucket.pop_back();
+
+		//move the last entity of the store into the freed slot
+		Uint32 last = Count() - 1;
+		Entity* moved = NULL;
+		if (slot != last)
+		{
+			x[slot] = x[last];
+			y[slot] = y[last];
+			prevX[slot] = prevX[last];
+			prevY[slot] = prevY[last];
+			width[slot] = width[last];
+			height[slot] = height[last];
+			spriteIndex[slot] = spriteIndex[last];
+			color[slot] = color[last];
+			type[slot] = type[last];
+			views[slot] = views[last];
+			typeIndex[slot] = typeIndex[last];
+			slotsByType[type[slot]][typeIndex[slot]] = slot;
+			moved = views[slot];
+		}
+
+		x.pop_back();
+		y.pop_back();
+		prevX.pop_back();
+		prevY.pop_back();
+		width.pop_back();
+		height.pop_back();
+		spriteIndex.pop_back();
+		color.pop_back();
+		type.pop_back();
+		views.pop_back();
+		typeIndex.pop_back();
+		return moved;
+	}
+
+	//removes all the entities, type names are kept
+	void Clear()
+	{
+		x.clear();
+		y.clear();
+		prevX.clear();
+		prevY.clear();
+		width.clear();
+		height.clear();
+		spriteIndex.clear();
+		color.clear();
+		type.clear();
+		views.clear();
+		typeIndex.clear();
+		for (std::vector<Uint32>& slots : slotsByType)
+			slots.clear();
+	}
+
+	//returns the type with the given name, or -1 if no entity type has that name
+	int FindType(const char* name) const
+	{
+		return typeNames.Find(name);
+	}
+
+	//returns the type with the given name, registering it if needed
+	Uint16 GetType(const char* name)
+	{
+		Uint16 id = typeNames.Intern(name);
+		if (slotsByType.size() <= id)
+		{
+			slotsByType.resize(id + 1);
+			staticType.resize(id + 1, false);
+		}
+		return id;
+	}
+
+	//returns all the entities of the given type
+	EntitySpan OfType(Uint16 entityType) const
+	{
+		if (entityType >= slotsByType.size())
+			return EntitySpan(NULL, 0, NULL);
+		return EntitySpan(slotsByType[entityType].data(), (Uint32)slotsByType[entityType].size(), views.data());
+	}
+
+	//returns the first entity of the given type, or NULL if there is none
+	Entity* FindFirst(Uint16 entityType) const
+	{
+		if (entityType >= slotsByType.size() || slotsByType[entityType].empty())
+			return NULL;
+		return views[slotsByType[entityType][0]];
+	}
+};
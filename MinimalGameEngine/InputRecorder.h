@@ -0,0 +1,99 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <fstream>
+#include <string>
+#include <cstring>
+
+static const char INPUTRECORDING_MAGIC[4] = { 'M', 'G', 'E', 'I' };
+static const Uint8 INPUTRECORDING_VERSION = 1;
+
+//writes and reads back the per-frame input state of a play session
+//file layout: 4 bytes magic, 1 byte version, then 9 bytes per frame: the held (low nibble) and pressed (high nibble) flags of the 4 directions followed by the frame delta as a little endian double
+class InputRecorder
+{
+public:
+	//starts a new recording, overwriting the file if it already exists
+	bool OpenForRecording(const std::string& path)
+	{
+		Close();
+		output.open(path.c_str(), std::ios::binary | std::ios::trunc);
+		if (!output.is_open())
+			return false;
+
+		output.write(INPUTRECORDING_MAGIC, 4);
+		output.put((char)INPUTRECORDING_VERSION);
+		return output.good();
+	}
+
+	//opens a recording for replay, returns false if the file is missing or not a recording
+	bool OpenForReplay(const std::string& path)
+	{
+		Close();
+		input.open(path.c_str(), std::ios::binary);
+		if (!input.is_open())
+			return false;
+
+		char magic[4];
+		input.read(magic, 4);
+		int version = input.get();
+		if (!input.good() || memcmp(magic, INPUTRECORDING_MAGIC, 4) != 0 || version != INPUTRECORDING_VERSION)
+		{
+			input.close();
+			return false;
+		}
+		return true;
+	}
+
+	//appends a frame to the recording
+	void WriteFrame(const bool held[4], const bool pressed[4], double frameDelta)
+	{
+		Uint8 flags = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			if (held[i])
+				flags |= 1 << i;
+			if (pressed[i])
+				flags |= 1 << (i + 4);
+		}
+
+		Uint64 bits;
+		memcpy(&bits, &frameDelta, sizeof(bits));
+		bits = SDL_SwapLE64(bits);
+
+		output.put((char)flags);
+		output.write((const char*)&bits, sizeof(bits));
+	}
+
+	//reads the next frame of the recording, returns false once the recording is over
+	bool ReadFrame(bool held[4], bool pressed[4], double& frameDelta)
+	{
+		int flags = input.get();
+		Uint64 bits;
+		input.read((char*)&bits, sizeof(bits));
+		if (flags == EOF || !input.good())
+			return false;
+
+		for (int i = 0; i < 4; i++)
+		{
+			held[i] = (flags & (1 << i)) != 0;
+			pressed[i] = (flags & (1 << (i + 4))) != 0;
+		}
+
+		bits = SDL_SwapLE64(bits);
+		memcpy(&frameDelta, &bits, sizeof(frameDelta));
+		return true;
+	}
+
+	//flushes and closes any open recording
+	void Close()
+	{
+		if (output.is_open())
+			output.close();
+		if (input.is_open())
+			input.close();
+	}
+
+private:
+	std::ofstream output;
+	std::ifstream input;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//interns names to small integer IDs, lookups hash the raw characters so they never build a temporary std::string
+class NameTable
+{
+public:
+	NameTable()
+	{
+		buckets.assign(64, -1);
+	}
+
+public:
+	//returns the ID of the given name, or -1 if it was never interned
+	int Find(const char* name) const
+	{
+		Uint32 mask = (Uint32)buckets.size() - 1;
+		for (Uint32 i = Hash(name) & mask; buckets[i] != -1; i = (i + 1) & mask)
+		{
+			if (strcmp(names[buckets[i]].c_str(), name) == 0)
+				return buckets[i];
+		}
+		return -1;
+	}
+
+	//returns the ID of the given name, interning it if needed
+	Uint16 Intern(const char* name)
+	{
+		int found = Find(name);
+		if (found != -1)
+			return (Uint16)found;
+
+		//keep the table at most half full so probe sequences stay short
+		if ((names.size() + 1) * 2 > buckets.size())
+			Rehash(buckets.size() * 2);
+
+		Uint16 id = (Uint16)names.size();
+		names.push_back(name);
+		Insert(id);
+		return id;
+	}
+
+	//returns the name with the given ID
+	const std::string& Get(Uint16 id) const
+	{
+		return names[id];
+	}
+
+	//number of interned names
+	size_t Count() const
+	{
+		return names.size();
+	}
+
+private:
+	std::vector<std::string> names;
+	std::vector<int> buckets; //open addressing table of IDs, -1 marks an empty bucket
+
+	//FNV-1a
+	static Uint32 Hash(const char* name)
+	{
+		Uint32 hash = 2166136261u;
+		for (; *name; name++)
+		{
+			hash ^= (Uint8)*name;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	void Insert(Uint16 id)
+	{
+		Uint32 mask = (Uint32)buckets.size() - 1;
+		Uint32 i = Hash(names[id].c_str()) & mask;
+		while (buckets[i] != -1)
+			i = (i + 1) & mask;
+		buckets[i] = id;
+	}
+
+	void Rehash(size_t size)
+	{
+		buckets.assign(size, -1);
+		for (size_t id = 0; id < names.size(); id++)
+			Insert((Uint16)id);
+	}
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <atomic>
+#include <fstream>
+#include <string>
+
+static const int PROFILER_FRAMES = 256; //number of recent frames kept in the ring
+static const int PROFILER_ZONES = 256; //zones recorded per frame, any extra zone in the same frame is dropped
+
+//a single timed zone, name has to point to a string that outlives the profiler (e.g. a literal)
+struct ProfileZoneRecord
+{
+	const char* name;
+	Uint64 start;
+	Uint64 end;
+	SDL_threadID thread;
+};
+
+//all the zones recorded during a frame
+struct ProfileFrame
+{
+	Uint64 start = 0;
+	Uint64 end = 0;
+	std::atomic<Uint32> zoneCount;
+	ProfileZoneRecord zones[PROFILER_ZONES];
+};
+
+//keeps the timing zones of the most recent frames in a ring and exports them in the Chrome trace event format (chrome://tracing, ui.perfetto.dev)
+//zones can be submitted from any thread without locking, frames have to be started and ended by the main thread
+class Profiler
+{
+public:
+	Profiler()
+	{
+		frames = new ProfileFrame[PROFILER_FRAMES];
+		for (int i = 0; i < PROFILER_FRAMES; i++)
+			frames[i].zoneCount = 0;
+		epoch = SDL_GetPerformanceCounter();
+	}
+
+	~Profiler()
+	{
+		delete[] frames;
+	}
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+public:
+	bool enabled = false;
+
+	//starts recording a new frame, overwriting the oldest one in the ring
+	void BeginFrame()
+	{
+		if (!enabled)
+			return;
+
+		Uint32 index = (frameIndex.load(std::memory_order_relaxed) + 1) % PROFILER_FRAMES;
+		ProfileFrame& frame = frames[index];
+		frame.zoneCount.store(0, std::memory_order_relaxed);
+		frame.start = SDL_GetPerformanceCounter();
+		frame.end = frame.start;
+		frameIndex.store(index, std::memory_order_release);
+		if (framesRecorded < PROFILER_FRAMES)
+			framesRecorded++;
+	}
+
+	//closes the frame started by BeginFrame
+	void EndFrame()
+	{
+		if (!enabled || framesRecorded == 0)
+			return;
+
+		frames[frameIndex.load(std::memory_order_relaxed)].end = SDL_GetPerformanceCounter();
+	}
+
+	//records a zone in the current frame, this is what ProfileZone calls when it goes out of scope
+	void SubmitZone(const char* name, Uint64 start, Uint64 end)
+	{
+		if (!enabled || framesRecorded == 0)
+			return;
+
+		ProfileFrame& frame = frames[frameIndex.load(std::memory_order_acquire)];
+		Uint32 slot = frame.zoneCount.fetch_add(1, std::memory_order_relaxed);
+		if (slot < PROFILER_ZONES)
+			frame.zones[slot] = { name, start, end, SDL_ThreadID() };
+	}
+
+	//writes the recorded frames as a Chrome trace event JSON file, returns false if the file could not be written
+	bool ExportChromeTrace(const std::string& path)
+	{
+		std::ofstream file(path.c_str());
+		if (!file.is_open())
+			return false;
+
+		SDL_threadID mainThread = SDL_ThreadID();
+		bool first = true;
+		file << "{\"traceEvents\":[\n";
+
+		//walk the ring from the oldest frame to the newest one
+		Uint32 newest = frameIndex.load(std::memory_order_acquire);
+		for (int i = framesRecorded - 1; i >= 0; i--)
+		{
+			ProfileFrame& frame = frames[(newest + PROFILER_FRAMES - i) % PROFILER_FRAMES];
+			WriteEvent(file, first, "Frame", frame.start, frame.end, mainThread);
+
+			Uint32 count = frame.zoneCount.load(std::memory_order_acquire);
+			if (count > PROFILER_ZONES)
+				count = PROFILER_ZONES;
+			for (Uint32 z = 0; z < count; z++)
+				WriteEvent(file, first, frame.zones[z].name, frame.zones[z].start, frame.zones[z].end, frame.zones[z].thread);
+		}
+
+		file << "\n]}\n";
+		return true;
+	}
+
+private:
+	ProfileFrame* frames;
+	std::atomic<Uint32> frameIndex{ PROFILER_FRAMES - 1 };
+	int framesRecorded = 0;
+	Uint64 epoch;
+
+	//writes a single complete ("X") event, timestamps are in microseconds since the profiler was created
+	void WriteEvent(std::ofstream& file, bool& first, const char* name, Uint64 start, Uint64 end, SDL_threadID thread)
+	{
+		double toMicroseconds = 1000000.0 / (double)SDL_GetPerformanceFrequency();
+		if (!first)
+			file << ",\n";
+		first = false;
+		file << "{\"name\":\"";
+		WriteEscaped(file, name);
+		file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread
+			<< ",\"ts\":" << (double)(start - epoch) * toMicroseconds
+			<< ",\"dur\":" << (double)(end - start) * toMicroseconds << "}";
+	}
+
+	//writes a zone name as the inside of a JSON string, quotes, backslashes and control characters are escaped
+	static void WriteEscaped(std::ofstream& file, const char* text)
+	{
+		for (; *text; text++)
+		{
+			unsigned char c = (unsigned char)*text;
+			if (c == '"' || c == '\\')
+				file << '\\' << (char)c;
+			else if (c < 0x20)
+			{
+				char code[7];
+				SDL_snprintf(code, sizeof(code), "\\u%04x", c);
+				file << code;
+			}
+			else
+				file << (char)c;
+		}
+	}
+};
+
+//times the scope it lives in and submits it to the profiler when destroyed
+class ProfileZone
+{
+public:
+	ProfileZone(Profiler& prof, const char* zoneName) : profiler(prof), name(zoneName)
+	{
+		start = profiler.enabled ? SDL_GetPerformanceCounter() : 0;
+	}
+
+	~ProfileZone()
+	{
+		if (profiler.enabled)
+			profiler.SubmitZone(name, start, SDL_GetPerformanceCounter());
+	}
+
+private:
+	Profiler& profiler;
+	const char* name;
+	Uint64 start;
+};
+
+//opens a zone that lasts until the end of the current scope, e.g. PROFILE_ZONE(eng->profiler, "Collision");
+#define PROFILE_ZONE_CONCAT_INNER(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(profiler, name) ProfileZone PROFILE_ZONE_CONCAT(profileZone, __LINE__)((profiler), (name))
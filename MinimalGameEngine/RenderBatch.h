@@ -0,0 +1,100 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <algorithm>
+#include <vector>
+
+//render backends, set Engine::renderBackend before calling Run
+static const int RENDER_SURFACE = 0; //CPU blits into the window surface
+static const int RENDER_SDL = 1; //SDL_Renderer with the sprites as textures, falls back to the software renderer where there is no GPU
+
+static const int RENDERBATCH_NOTEXTURE = -1; //texture of the commands that fill a rectangle with a color
+
+//a sprite copy or a color fill, drawn in layer order
+struct RenderCommand
+{
+	int layer;
+	int texture; //index in the textures passed to Submit, or RENDERBATCH_NOTEXTURE
+	SDL_Rect source;
+	SDL_Rect destination;
+	SDL_Color color;
+};
+
+//collects a frame's draws and submits them sorted by layer and texture, so draws that share a texture or a fill color go out together:
+//sprite copies in a row from the same texture and fills in a row of the same color, which become a single SDL_RenderFillRects
+class RenderBatch
+{
+public:
+	void Clear()
+	{
+		commands.clear();
+	}
+
+	void AddSprite(int layer, int texture, const SDL_Rect& source, const SDL_Rect& destination)
+	{
+		commands.push_back({ layer, texture, source, destination, { 255, 255, 255, 255 } });
+	}
+
+	void AddFill(int layer, const SDL_Rect& destination, SDL_Color color)
+	{
+		commands.push_back({ layer, RENDERBATCH_NOTEXTURE, destination, destination, color });
+	}
+
+	//sorts and draws the commands, returns the number of draw calls issued
+	int Submit(SDL_Renderer* renderer, const std::vector<SDL_Texture*>& textures)
+	{
+		//stable, so draws that compare equal keep the order they were added in
+		std::stable_sort(commands.begin(), commands.end(), [](const RenderCommand& a, const RenderCommand& b)
+		{
+			if (a.layer != b.layer)
+				return a.layer < b.layer;
+			if (a.texture != b.texture)
+				return a.texture < b.texture;
+			return a.texture == RENDERBATCH_NOTEXTURE && PackColor(a.color) < PackColor(b.color);
+		});
+
+		int calls = 0;
+		for (size_t i = 0; i < commands.size();)
+		{
+			const RenderCommand& command = commands[i];
+			if (command.texture != RENDERBATCH_NOTEXTURE)
+			{
+				if ((size_t)command.texture < textures.size())
+				{
+					SDL_RenderCopy(renderer, textures[command.texture], &command.source, &command.destination);
+					calls++;
+				}
+				i++;
+				continue;
+			}
+
+			//gather the run of fills of the same color
+			fills.clear();
+			size_t end = i;
+			while (end < commands.size() && commands[end].layer == command.layer && commands[end].texture == RENDERBATCH_NOTEXTURE &&
+				PackColor(commands[end].color) == PackColor(command.color))
+			{
+				fills.push_back(commands[end].destination);
+				end++;
+			}
+			SDL_SetRenderDrawColor(renderer, command.color.r, command.color.g, command.color.b, command.color.a);
+			SDL_RenderFillRects(renderer, fills.data(), (int)fills.size());
+			calls++;
+			i = end;
+		}
+		return calls;
+	}
+
+	size_t Count() const
+	{
+		return commands.size();
+	}
+
+private:
+	std::vector<RenderCommand> commands;
+	std::vector<SDL_Rect> fills;
+
+	static Uint32 PackColor(SDL_Color color)
+	{
+		return ((Uint32)color.r << 24) | ((Uint32)color.g << 16) | ((Uint32)color.b << 8) | color.a;
+	}
+};
@@ -0,0 +1,375 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <cmath>
+#include <vector>
+#include "AABB.h"
+#include "Entity.h"
+
+//an entity registered in a cell of the spatial hash, the box is cached so queries never touch the entity store
+struct SpatialHashEntry
+{
+	EntityHandle handle;
+	Uint16 type;
+	Sint32 cellX, cellY;
+	AABB box;
+};
+
+//an entity found by a raycast or an overlap query
+struct QueryHit
+{
+	EntityHandle handle;
+	float distance; //along the ray, or from the query's center to the entity's box
+	float x, y; //point where the ray enters the box, or point of the box closest to the query's center
+	float normalX, normalY; //face the ray enters through, zero for overlap queries
+};
+
+//uniform grid of ENTITYSIZE cells hashed into a fixed number of buckets, entities are registered in every cell their box overlaps
+//cells are offset by half an entity so an entity sitting on the level grid covers exactly one cell
+//queries only read the table and write into caller provided buffers, so they can run on several threads as long as nothing is inserted or moved meanwhile
+class SpatialHash
+{
+public:
+	SpatialHash()
+	{
+		Clear(0);
+	}
+
+public:
+	//removes every entity and sizes the table for the expected number of entities
+	void Clear(size_t expectedEntities)
+	{
+		size_t size = 64;
+		while (size < expectedEntities)
+			size *= 2;
+
+		for (std::vector<SpatialHashEntry>& bucket : buckets)
+			bucket.clear();
+		buckets.resize(size);
+		tracked.clear();
+		entryCount = 0;
+	}
+
+	//registers an entity with the given bounds
+	void Insert(EntityHandle handle, Uint16 type, const AABB& box)
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		if (tracked.size() <= index)
+			tracked.resize(index + 1, { INVALID_ENTITY, 0, 0, 0, { 0, 0, 0, 0 } });
+
+		tracked[index] = { handle, type, 0, 0, box };
+		AddEntries(tracked[index]);
+
+		//grow when buckets get crowded
+		if (entryCount > buckets.size() * 2)
+			Rehash(buckets.size() * 2);
+	}
+
+	//unregisters an entity
+	void Remove(EntityHandle handle)
+	{
+		SpatialHashEntry* entity = Find(handle);
+		if (!entity)
+			return;
+
+		RemoveEntries(*entity);
+		entity->handle = INVALID_ENTITY;
+	}
+
+	//updates the bounds of a registered entity, entries are only moved between buckets when the entity changes cells
+	void Move(EntityHandle handle, const AABB& box)
+	{
+		SpatialHashEntry* entity = Find(handle);
+		if (!entity)
+			return;
+
+		Sint32 oldMinX, oldMinY, oldMaxX, oldMaxY, newMinX, newMinY, newMaxX, newMaxY;
+		CellRange(entity->box, oldMinX, oldMinY, oldMaxX, oldMaxY);
+		CellRange(box, newMinX, newMinY, newMaxX, newMaxY);
+
+		if (oldMinX == newMinX && oldMinY == newMinY && oldMaxX == newMaxX && oldMaxY == newMaxY)
+		{
+			//same cells, refresh the cached box in place
+			for (Sint32 cy = oldMinY; cy <= oldMaxY; cy++)
+			{
+				for (Sint32 cx = oldMinX; cx <= oldMaxX; cx++)
+				{
+					for (SpatialHashEntry& entry : buckets[Bucket(cx, cy)])
+					{
+						if (entry.handle == handle)
+							entry.box = box;
+					}
+				}
+			}
+			entity->box = box;
+		}
+		else
+		{
+			RemoveEntries(*entity);
+			entity->box = box;
+			AddEntries(*entity);
+		}
+	}
+
+	//returns the bounds an entity was registered with
+	bool GetBounds(EntityHandle handle, AABB& box) const
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		if (index >= tracked.size() || tracked[index].handle != handle)
+			return false;
+
+		box = tracked[index].box;
+		return true;
+	}
+
+	//finds the entities whose box contains the point, type -1 matches every type, returns the number of handles written
+	int QueryPoint(float x, float y, EntityHandle* out, int capacity, int type = -1) const
+	{
+		int found = 0;
+		Sint32 cx = CellOf(x), cy = CellOf(y);
+		for (const SpatialHashEntry& entry : buckets[Bucket(cx, cy)])
+		{
+			if (found == capacity)
+				break;
+			if (entry.cellX == cx && entry.cellY == cy && (type == -1 || entry.type == type) && entry.box.Contains(x, y))
+				out[found++] = entry.handle;
+		}
+		return found;
+	}
+
+	//finds the entities whose box overlaps the given one, type -1 matches every type, returns the number of handles written
+	int QueryAABB(const AABB& box, EntityHandle* out, int capacity, int type = -1) const
+	{
+		int found = 0;
+		if (capacity <= 0)
+			return 0;
+		VisitAABB(box, type, [&](const SpatialHashEntry& entry)
+		{
+			out[found++] = entry.handle;
+			return found < capacity;
+		});
+		return found;
+	}
+
+	//finds the entities overlapping a box, the capacity closest to its center are written to out by increasing distance
+	int OverlapBox(const AABB& box, QueryHit* out, int capacity, int type = -1) const
+	{
+		int found = 0;
+		float centerX = (box.minX + box.maxX) / 2, centerY = (box.minY + box.maxY) / 2;
+		VisitAABB(box, type, [&](const SpatialHashEntry& entry)
+		{
+			found = InsertHit(out, found, capacity, ClosestHit(entry, centerX, centerY));
+			return true;
+		});
+		return found;
+	}
+
+	//finds the entities overlapping a circle, the capacity closest to its center are written to out by increasing distance
+	int OverlapCircle(float centerX, float centerY, float radius, QueryHit* out, int capacity, int type = -1) const
+	{
+		int found = 0;
+		VisitAABB({ centerX - radius, centerY - radius, centerX + radius, centerY + radius }, type, [&](const SpatialHashEntry& entry)
+		{
+			QueryHit hit = ClosestHit(entry, centerX, centerY);
+			if (hit.distance < radius)
+				found = InsertHit(out, found, capacity, hit);
+			return true;
+		});
+		return found;
+	}
+
+	//casts a ray from x, y along the normalized direction dirX, dirY for up to maxDistance, walking the cells it crosses in order (DDA)
+	//the capacity closest entities hit are written to out by increasing distance, boxes containing the start of the ray are ignored
+	//so a ray cast from an entity's position doesn't hit that entity
+	int Raycast(float x, float y, float dirX, float dirY, float maxDistance, QueryHit* out, int capacity, int type = -1) const
+	{
+		if ((dirX == 0 && dirY == 0) || maxDistance <= 0 || capacity <= 0)
+			return 0;
+
+		//the ray is swept as a point box, which gives the entry distance and face of each box it meets
+		AABB origin = { x, y, x, y };
+		float moveX = dirX * maxDistance, moveY = dirY * maxDistance;
+
+		Sint32 cx = CellOf(x), cy = CellOf(y);
+		Sint32 stepX = dirX > 0 ? 1 : -1, stepY = dirY > 0 ? 1 : -1;
+		float deltaX = dirX != 0 ? ENTITYSIZE / fabsf(dirX) : INFINITY;
+		float deltaY = dirY != 0 ? ENTITYSIZE / fabsf(dirY) : INFINITY;
+		float nextX = dirX != 0 ? ((cx + (dirX > 0 ? 1 : 0)) * ENTITYSIZE - ENTITYSIZE / 2 - x) / dirX : INFINITY;
+		float nextY = dirY != 0 ? ((cy + (dirY > 0 ? 1 : 0)) * ENTITYSIZE - ENTITYSIZE / 2 - y) / dirY : INFINITY;
+
+		int found = 0;
+		float cellDistance = 0; //distance at which the ray enters the current cell
+		while (cellDistance <= maxDistance)
+		{
+			//hits found further on can't be closer than the cell they are found in
+			if (found == capacity && cellDistance > out[found - 1].distance)
+				break;
+
+			for (const SpatialHashEntry& entry : buckets[Bucket(cx, cy)])
+			{
+				float time, normalX, normalY;
+				if (entry.cellX != cx || entry.cellY != cy || (type != -1 && entry.type != type) || entry.box.Contains(x, y) ||
+					!origin.Sweep(moveX, moveY, entry.box, time, normalX, normalY))
+					continue;
+
+				float distance = time * maxDistance;
+				found = InsertHit(out, found, capacity, { entry.handle, distance, x + dirX * distance, y + dirY * distance, normalX, normalY });
+			}
+
+			if (nextX < nextY)
+			{
+				cellDistance = nextX;
+				nextX += deltaX;
+				cx += stepX;
+			}
+			else
+			{
+				cellDistance = nextY;
+				nextY += deltaY;
+				cy += stepY;
+			}
+		}
+		return found;
+	}
+
+	//finds the entities that a box moving by dX, dY could touch, these are candidates for an exact swept test
+	int QuerySweptAABB(const AABB& box, float dX, float dY, EntityHandle* out, int capacity, int type = -1) const
+	{
+		return QueryAABB(box.Swept(dX, dY), out, capacity, type);
+	}
+
+	//cell containing the given world coordinate
+	static Sint32 CellOf(float coordinate)
+	{
+		return (Sint32)floorf((coordinate + ENTITYSIZE / 2) / ENTITYSIZE);
+	}
+
+private:
+	std::vector<std::vector<SpatialHashEntry>> buckets;
+	std::vector<SpatialHashEntry> tracked; //registered entities, indexed by handle index
+	size_t entryCount = 0;
+
+	Uint32 Bucket(Sint32 cx, Sint32 cy) const
+	{
+		return ((Uint32)cx * 73856093u ^ (Uint32)cy * 19349663u) & (Uint32)(buckets.size() - 1);
+	}
+
+	//range of cells covered by a box, the max edge is exclusive
+	static void CellRange(const AABB& box, Sint32& minX, Sint32& minY, Sint32& maxX, Sint32& maxY)
+	{
+		minX = CellOf(box.minX);
+		minY = CellOf(box.minY);
+		maxX = SDL_max(minX, (Sint32)ceilf((box.maxX + ENTITYSIZE / 2) / ENTITYSIZE) - 1);
+		maxY = SDL_max(minY, (Sint32)ceilf((box.maxY + ENTITYSIZE / 2) / ENTITYSIZE) - 1);
+	}
+
+	//calls visit with every entity overlapping the box once, visit returns false to stop
+	template <typename Visitor> void VisitAABB(const AABB& box, int type, Visitor visit) const
+	{
+		Sint32 minX, minY, maxX, maxY;
+		CellRange(box, minX, minY, maxX, maxY);
+
+		for (Sint32 cy = minY; cy <= maxY; cy++)
+		{
+			for (Sint32 cx = minX; cx <= maxX; cx++)
+			{
+				for (const SpatialHashEntry& entry : buckets[Bucket(cx, cy)])
+				{
+					if (entry.cellX != cx || entry.cellY != cy || (type != -1 && entry.type != type) || !entry.box.Overlaps(box))
+						continue;
+
+					//an entity spanning several cells is only reported from the first cell shared with the query
+					if (cx != SDL_max(minX, CellOf(entry.box.minX)) || cy != SDL_max(minY, CellOf(entry.box.minY)))
+						continue;
+
+					if (!visit(entry))
+						return;
+				}
+			}
+		}
+	}
+
+	//hit on the point of an entity's box closest to the given point
+	static QueryHit ClosestHit(const SpatialHashEntry& entry, float x, float y)
+	{
+		float closestX = SDL_max(entry.box.minX, SDL_min(x, entry.box.maxX));
+		float closestY = SDL_max(entry.box.minY, SDL_min(y, entry.box.maxY));
+		float distance = sqrtf((closestX - x) * (closestX - x) + (closestY - y) * (closestY - y));
+		return { entry.handle, distance, closestX, closestY, 0, 0 };
+	}
+
+	//inserts a hit into a list sorted by distance, keeping only the capacity closest ones and each entity once, returns the new count
+	static int InsertHit(QueryHit* out, int found, int capacity, const QueryHit& hit)
+	{
+		for (int i = 0; i < found; i++)
+		{
+			if (out[i].handle == hit.handle)
+				return found;
+		}
+		if (found == capacity && (capacity == 0 || hit.distance >= out[found - 1].distance))
+			return found;
+
+		int at = found < capacity ? found++ : found - 1;
+		for (; at > 0 && out[at - 1].distance > hit.distance; at--)
+			out[at] = out[at - 1];
+		out[at] = hit;
+		return found;
+	}
+
+	SpatialHashEntry* Find(EntityHandle handle)
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		if (index >= tracked.size() || tracked[index].handle != handle)
+			return NULL;
+		return &tracked[index];
+	}
+
+	void AddEntries(const SpatialHashEntry& entity)
+	{
+		Sint32 minX, minY, maxX, maxY;
+		CellRange(entity.box, minX, minY, maxX, maxY);
+		for (Sint32 cy = minY; cy <= maxY; cy++)
+		{
+			for (Sint32 cx = minX; cx <= maxX; cx++)
+			{
+				buckets[Bucket(cx, cy)].push_back({ entity.handle, entity.type, cx, cy, entity.box });
+				entryCount++;
+			}
+		}
+	}
+
+	void RemoveEntries(const SpatialHashEntry& entity)
+	{
+		Sint32 minX, minY, maxX, maxY;
+		CellRange(entity.box, minX, minY, maxX, maxY);
+		for (Sint32 cy = minY; cy <= maxY; cy++)
+		{
+			for (Sint32 cx = minX; cx <= maxX; cx++)
+			{
+				std::vector<SpatialHashEntry>& bucket = buckets[Bucket(cx, cy)];
+				for (size_t i = 0; i < bucket.size(); i++)
+				{
+					if (bucket[i].handle == entity.handle && bucket[i].cellX == cx && bucket[i].cellY == cy)
+					{
+						bucket[i] = bucket.back();
+						bucket.pop_back();
+						entryCount--;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	void Rehash(size_t size)
+	{
+		for (std::vector<SpatialHashEntry>& bucket : buckets)
+			bucket.clear();
+		buckets.resize(size);
+		entryCount = 0;
+		for (const SpatialHashEntry& entity : tracked)
+		{
+			if (entity.handle != INVALID_ENTITY)
+				AddEntries(entity);
+		}
+	}
+};
@@ -0,0 +1,410 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static const int SPRITEATLAS_PAGESIZE = 1024; //width of the atlas pages, and the most they grow in height
+
+//where a sprite lives in the atlas
+struct AtlasRegion
+{
+	int page;
+	SDL_Rect rect;
+};
+
+//skyline rectangle packer: the used part of a page is described by its top outline, a row of segments of different heights,
+//each rectangle goes where its bottom edge ends up the lowest, which keeps the wasted space under the outline small
+class SkylinePacker
+{
+public:
+	void Reset(int pageWidth, int pageHeight)
+	{
+		width = pageWidth;
+		height = pageHeight;
+		usedHeight = 0;
+		skyline.assign(1, { 0, 0, pageWidth });
+	}
+
+	//finds room for a w x h rectangle and reserves it, returns false if the page is full
+	bool Pack(int w, int h, SDL_Point& at)
+	{
+		int bestSegment = -1, bestY = height, bestX = 0;
+		for (size_t i = 0; i < skyline.size(); i++)
+		{
+			int y;
+			if (Fits(i, w, h, y) && (y < bestY || (y == bestY && skyline[i].x < bestX)))
+			{
+				bestSegment = (int)i;
+				bestY = y;
+				bestX = skyline[i].x;
+			}
+		}
+		if (bestSegment == -1)
+			return false;
+
+		//the new rectangle's top becomes a segment, the segments it covers are shortened or removed
+		Segment added = { bestX, bestY + h, w };
+		skyline.insert(skyline.begin() + bestSegment, added);
+		for (size_t i = bestSegment + 1; i < skyline.size();)
+		{
+			int overlap = added.x + added.width - skyline[i].x;
+			if (overlap <= 0)
+				break;
+			if (overlap < skyline[i].width)
+			{
+				skyline[i].x += overlap;
+				skyline[i].width -= overlap;
+				break;
+			}
+			skyline.erase(skyline.begin() + i);
+		}
+
+		//neighbours at the same height are one segment
+		for (size_t i = 0; i + 1 < skyline.size();)
+		{
+			if (skyline[i].y == skyline[i + 1].y)
+			{
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+			}
+			else
+				i++;
+		}
+
+		at.x = bestX;
+		at.y = bestY;
+		usedHeight = SDL_max(usedHeight, bestY + h);
+		return true;
+	}
+
+	int UsedHeight() const
+	{
+		return usedHeight;
+	}
+
+private:
+	struct Segment
+	{
+		int x, y, width;
+	};
+	std::vector<Segment> skyline;
+	int width = 0, height = 0, usedHeight = 0;
+
+	//a rectangle starting at segment i rests on the highest segment under it
+	bool Fits(size_t i, int w, int h, int& y) const
+	{
+		if (skyline[i].x + w > width)
+			return false;
+
+		y = 0;
+		int left = w;
+		for (size_t j = i; left > 0; j++)
+		{
+			if (j == skyline.size())
+				return false;
+			y = SDL_max(y, skyline[j].y);
+			if (y + h > height)
+				return false;
+			left -= skyline[j].width;
+		}
+		return true;
+	}
+};
+
+//a sprite copied out of the atlas at another size
+struct ScaledSprite
+{
+	int sprite;
+	int width, height;
+	SDL_Surface* surface;
+};
+
+//all the sprites packed into a few large surfaces, sprites are drawn by their index as before but every blit reads from the same few images
+//sprites share the 255,0,255 transparent color, the pages are color keyed and RLE encoded
+class SpriteAtlas
+{
+public:
+	SpriteAtlas()
+	{
+	}
+
+	~SpriteAtlas()
+	{
+		Clear();
+	}
+
+	SpriteAtlas(const SpriteAtlas&) = delete;
+	SpriteAtlas& operator=(const SpriteAtlas&) = delete;
+
+public:
+	//frees the pages and the scaled copies
+	void Clear()
+	{
+		for (SDL_Surface* page : pages)
+			SDL_FreeSurface(page);
+		pages.clear();
+		regions.clear();
+		for (const ScaledSprite& copy : scaled)
+			SDL_FreeSurface(copy.surface);
+		scaled.clear();
+	}
+
+	//packs the images, which must all have the same pixel format, the images stay owned by the caller
+	bool Build(const std::vector<SDL_Surface*>& images)
+	{
+		Clear();
+		if (images.empty())
+			return true;
+
+		//tallest first packs tighter
+		std::vector<size_t> order(images.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&images](size_t a, size_t b)
+		{
+			return images[a]->h != images[b]->h ? images[a]->h > images[b]->h : images[a]->w > images[b]->w;
+		});
+
+		regions.resize(images.size());
+		std::vector<SkylinePacker> packers;
+		for (size_t i : order)
+		{
+			SDL_Surface* image = images[i];
+			if (image->w > SPRITEATLAS_PAGESIZE || image->h > SPRITEATLAS_PAGESIZE)
+				return false;
+
+			SDL_Point at;
+			size_t page = 0;
+			while (page < packers.size() && !packers[page].Pack(image->w, image->h, at))
+				page++;
+			if (page == packers.size())
+			{
+				packers.push_back(SkylinePacker());
+				packers.back().Reset(SPRITEATLAS_PAGESIZE, SPRITEATLAS_PAGESIZE);
+				packers.back().Pack(image->w, image->h, at);
+			}
+			regions[i] = { (int)page, { at.x, at.y, image->w, image->h } };
+		}
+
+		//pages only need to be as tall as what was packed into them, gaps are left transparent
+		SDL_PixelFormat* format = images[0]->format;
+		for (const SkylinePacker& packer : packers)
+		{
+			SDL_Surface* page = SDL_CreateRGBSurfaceWithFormat(0, SPRITEATLAS_PAGESIZE, packer.UsedHeight(), format->BitsPerPixel, format->format);
+			if (!page)
+				return false;
+			SDL_FillRect(page, NULL, SDL_MapRGB(page->format, 255, 0, 255));
+			pages.push_back(page);
+		}
+
+		//copy the pixels as they are, key color included
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			Uint32 key;
+			bool keyed = SDL_GetColorKey(images[i], &key) == 0;
+			SDL_BlendMode blendMode;
+			SDL_GetSurfaceBlendMode(images[i], &blendMode);
+			SDL_SetColorKey(images[i], SDL_FALSE, 0);
+			SDL_SetSurfaceBlendMode(images[i], SDL_BLENDMODE_NONE);
+
+			SDL_Rect destination = regions[i].rect;
+			SDL_BlitSurface(images[i], NULL, pages[regions[i].page], &destination);
+
+			SDL_SetSurfaceBlendMode(images[i], blendMode);
+			if (keyed)
+				SDL_SetColorKey(images[i], SDL_TRUE, key);
+		}
+
+		PreparePages();
+		return true;
+	}
+
+	//saves the pages as path0.bmp, path1.bmp... and the region table as path.txt, fingerprints identify the source images
+	bool Save(const std::string& path, const std::vector<Uint64>& fingerprints)
+	{
+		if (fingerprints.size() != regions.size())
+			return false;
+
+		std::ofstream table((path + ".txt").c_str());
+		if (!table.is_open())
+			return false;
+
+		table << "atlas " << regions.size() << " " << pages.size() << "\n";
+		for (size_t i = 0; i < regions.size(); i++)
+		{
+			const AtlasRegion& region = regions[i];
+			table << region.page << " " << region.rect.x << " " << region.rect.y << " " << region.rect.w << " " << region.rect.h << " " << fingerprints[i] << "\n";
+		}
+
+		for (size_t page = 0; page < pages.size(); page++)
+		{
+			if (SDL_SaveBMP(pages[page], (path + std::to_string(page) + ".bmp").c_str()) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	//loads an atlas written by Save, returns false if there is none or it was packed from different images
+	bool Load(const std::string& path, const std::vector<Uint64>& fingerprints, SDL_PixelFormat* format)
+	{
+		Clear();
+		std::ifstream table((path + ".txt").c_str());
+		if (!table.is_open())
+			return false;
+
+		std::string magic;
+		size_t regionCount = 0, pageCount = 0;
+		table >> magic >> regionCount >> pageCount;
+		if (magic != "atlas" || regionCount != fingerprints.size())
+			return false;
+
+		regions.resize(regionCount);
+		for (size_t i = 0; i < regionCount; i++)
+		{
+			AtlasRegion& region = regions[i];
+			Uint64 fingerprint;
+			if (!(table >> region.page >> region.rect.x >> region.rect.y >> region.rect.w >> region.rect.h >> fingerprint) ||
+				fingerprint != fingerprints[i] || region.page < 0 || (size_t)region.page >= pageCount)
+			{
+				Clear();
+				return false;
+			}
+		}
+
+		for (size_t page = 0; page < pageCount; page++)
+		{
+			SDL_Surface* loaded = SDL_LoadBMP((path + std::to_string(page) + ".bmp").c_str());
+			SDL_Surface* converted = loaded ? SDL_ConvertSurface(loaded, format, 0) : NULL;
+			SDL_FreeSurface(loaded);
+			if (!converted)
+			{
+				Clear();
+				return false;
+			}
+			pages.push_back(converted);
+		}
+
+		PreparePages();
+		return true;
+	}
+
+	//deletes the files of an atlas written by Save
+	static void Remove(const std::string& path)
+	{
+		std::ifstream table((path + ".txt").c_str());
+		if (!table.is_open())
+			return;
+
+		std::string magic;
+		size_t regionCount = 0, pageCount = 0;
+		table >> magic >> regionCount >> pageCount;
+		table.close();
+		if (magic == "atlas")
+		{
+			for (size_t page = 0; page < pageCount; page++)
+				std::remove((path + std::to_string(page) + ".bmp").c_str());
+		}
+		std::remove((path + ".txt").c_str());
+	}
+
+	//FNV-1a of a file's contents, identifies a source image for Save and Load, returns false if the file can't be read
+	static bool Fingerprint(const std::string& file, Uint64& fingerprint)
+	{
+		std::ifstream f(file.c_str(), std::ios::binary);
+		if (!f.good())
+			return false;
+
+		fingerprint = 14695981039346656037ull;
+		for (std::istreambuf_iterator<char> it(f), end; it != end; ++it)
+		{
+			fingerprint ^= (Uint8)*it;
+			fingerprint *= 1099511628211ull;
+		}
+		return true;
+	}
+
+	//returns a copy of a sprite scaled to width x height, made the first time it is asked for, or NULL for the sprite's own size
+	//sprites drawn at another size are blitted from their copy: a scaled blit straight from a page would make SDL rebuild the page's
+	//blit mapping, RLE encoding included, every time scaled and plain blits from that page alternate
+	SDL_Surface* PrepareScaled(int sprite, int width, int height)
+	{
+		if (sprite < 0 || (size_t)sprite >= regions.size() || width <= 0 || height <= 0)
+			return NULL;
+		const AtlasRegion& region = regions[sprite];
+		if (region.rect.w == width && region.rect.h == height)
+			return NULL;
+
+		for (const ScaledSprite& copy : scaled)
+		{
+			if (copy.sprite == sprite && copy.width == width && copy.height == height)
+				return copy.surface;
+		}
+
+		SDL_Surface* page = pages[region.page];
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, page->format->BitsPerPixel, page->format->format);
+		if (!surface)
+			return NULL;
+
+		//copy the pixels as they are, key color included
+		Uint32 key = SDL_MapRGB(page->format, 255, 0, 255);
+		SDL_BlendMode blendMode;
+		SDL_GetSurfaceBlendMode(page, &blendMode);
+		SDL_SetColorKey(page, SDL_FALSE, 0);
+		SDL_SetSurfaceBlendMode(page, SDL_BLENDMODE_NONE);
+		SDL_Rect source = region.rect;
+		SDL_BlitScaled(page, &source, surface, NULL);
+		SDL_SetSurfaceBlendMode(page, blendMode);
+		SDL_SetColorKey(page, SDL_TRUE, key);
+
+		SDL_SetColorKey(surface, SDL_TRUE, key);
+		SDL_SetSurfaceRLE(surface, 1);
+		scaled.push_back({ sprite, width, height, surface });
+		return surface;
+	}
+
+	//draws a sprite into the rect, from its scaled copy if the rect's size differs from the sprite's
+	void Blit(int sprite, SDL_Surface* target, SDL_Rect* rect)
+	{
+		if (sprite < 0 || (size_t)sprite >= regions.size())
+			return;
+
+		const AtlasRegion& region = regions[sprite];
+		SDL_Rect source = region.rect;
+		if (rect->w == source.w && rect->h == source.h)
+			SDL_BlitSurface(pages[region.page], &source, target, rect);
+		else
+		{
+			SDL_Surface* copy = PrepareScaled(sprite, rect->w, rect->h);
+			if (copy)
+				SDL_BlitSurface(copy, NULL, target, rect);
+			else
+				SDL_BlitScaled(pages[region.page], &source, target, rect);
+		}
+	}
+
+	//number of sprites
+	size_t Count() const
+	{
+		return regions.size();
+	}
+
+public:
+	std::vector<SDL_Surface*> pages;
+	std::vector<AtlasRegion> regions; //indexed by sprite
+
+private:
+	std::vector<ScaledSprite> scaled; //copies of the sprites drawn at other sizes, there are only ever a few
+
+	void PreparePages()
+	{
+		for (SDL_Surface* page : pages)
+		{
+			SDL_SetColorKey(page, SDL_TRUE, SDL_MapRGB(page->format, 255, 0, 255));
+			SDL_SetSurfaceRLE(page, 1);
+		}
+	}
+};
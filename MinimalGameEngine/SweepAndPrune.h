@@ -0,0 +1,122 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <vector>
+#include "AABB.h"
+#include "EntityHandles.h"
+
+static const Uint32 SWEEPANDPRUNE_NONE = 0xFFFFFFFF; //entity not tracked
+
+//two entities whose boxes overlap
+struct EntityPair
+{
+	EntityHandle a, b;
+};
+
+//a tracked entity, kept sorted by box.minX
+struct SweepAndPruneEntry
+{
+	EntityHandle handle;
+	AABB box;
+};
+
+//sort and sweep broadphase for entities that move every frame: the boxes are kept sorted along x and re-sorted with an insertion sort,
+//which is close to linear because entities barely move between frames, then a single sweep finds every overlapping pair
+//the engine finds its pairs with the dynamic tree, which handles entities of any size, this is kept for the --bench-broadphase comparison
+class SweepAndPrune
+{
+public:
+	//removes every entity
+	void Clear()
+	{
+		entries.clear();
+		position.clear();
+	}
+
+	//starts tracking an entity, it is moved to its place in the order by the next FindPairs
+	void Insert(EntityHandle handle, const AABB& box)
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		if (position.size() <= index)
+			position.resize(index + 1, SWEEPANDPRUNE_NONE);
+
+		position[index] = (Uint32)entries.size();
+		entries.push_back({ handle, box });
+	}
+
+	//stops tracking an entity, the last entry takes its place and the next sort puts it back in order
+	void Remove(EntityHandle handle)
+	{
+		Uint32 at = Find(handle);
+		if (at == SWEEPANDPRUNE_NONE)
+			return;
+
+		entries[at] = entries.back();
+		position[entries[at].handle & ENTITYHANDLE_INDEXMASK] = at;
+		entries.pop_back();
+		position[handle & ENTITYHANDLE_INDEXMASK] = SWEEPANDPRUNE_NONE;
+	}
+
+	//updates the box of a tracked entity
+	void Move(EntityHandle handle, const AABB& box)
+	{
+		Uint32 at = Find(handle);
+		if (at != SWEEPANDPRUNE_NONE)
+			entries[at].box = box;
+	}
+
+	//restores the order along x and writes every overlapping pair to pairs, which is cleared first
+	void FindPairs(std::vector<EntityPair>& pairs)
+	{
+		pairs.clear();
+		Sort();
+
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			const AABB& box = entries[i].box;
+			//later entries start further right, so the sweep stops at the first one starting past this box
+			for (size_t j = i + 1; j < entries.size() && entries[j].box.minX < box.maxX; j++)
+			{
+				if (box.minY < entries[j].box.maxY && box.maxY > entries[j].box.minY && box.maxX > entries[j].box.minX)
+					pairs.push_back({ entries[i].handle, entries[j].handle });
+			}
+		}
+	}
+
+	size_t Count() const
+	{
+		return entries.size();
+	}
+
+private:
+	std::vector<SweepAndPruneEntry> entries; //sorted by box.minX after every FindPairs
+	std::vector<Uint32> position; //index of each tracked entity in entries, indexed by handle index
+
+	Uint32 Find(EntityHandle handle) const
+	{
+		Uint32 index = handle & ENTITYHANDLE_INDEXMASK;
+		if (index >= position.size() || position[index] == SWEEPANDPRUNE_NONE || entries[position[index]].handle != handle)
+			return SWEEPANDPRUNE_NONE;
+		return position[index];
+	}
+
+	//insertion sort on minX, entries only shift by the few places they moved since the last frame
+	void Sort()
+	{
+		for (size_t i = 1; i < entries.size(); i++)
+		{
+			if (entries[i - 1].box.minX <= entries[i].box.minX)
+				continue;
+
+			SweepAndPruneEntry entry = entries[i];
+			size_t j = i;
+			while (j > 0 && entries[j - 1].box.minX > entry.box.minX)
+			{
+				entries[j] = entries[j - 1];
+				position[entries[j].handle & ENTITYHANDLE_INDEXMASK] = (Uint32)j;
+				j--;
+			}
+			entries[j] = entry;
+			position[entry.handle & ENTITYHANDLE_INDEXMASK] = (Uint32)j;
+		}
+	}
+};
@@ -0,0 +1,143 @@
+#pragma once
+#include <SDL/SDL.h>
+#include <cmath>
+#include <vector>
+#include "BitUtils.h"
+#include "Entity.h"
+
+//one bit per level tile telling whether an entity of a given type sits there, kept both row by row and column by column
+//so horizontal and vertical spans are scanned 64 tiles at a time, tile (i, j) is the level pixel (i, j) and the entity at (i * ENTITYSIZE, j * ENTITYSIZE)
+class TileMap
+{
+public:
+	//empties the map and sizes it for a level of the given size in tiles
+	void Reset(int levelWidth, int levelHeight)
+	{
+		width = levelWidth;
+		height = levelHeight;
+		wordsPerRow = (width + 63) / 64;
+		wordsPerColumn = (height + 63) / 64;
+		for (size_t type = 0; type < rows.size(); type++)
+		{
+			rows[type].assign(rows[type].empty() ? 0 : wordsPerRow * height, 0);
+			columns[type].assign(columns[type].empty() ? 0 : wordsPerColumn * width, 0);
+		}
+	}
+
+	//marks a tile as occupied or free for the given type
+	void Set(int tileX, int tileY, Uint16 type, bool occupied)
+	{
+		if (tileX < 0 || tileY < 0 || tileX >= width || tileY >= height)
+			return;
+
+		if (rows.size() <= type)
+		{
+			rows.resize(type + 1);
+			columns.resize(type + 1);
+		}
+		if (rows[type].empty())
+		{
+			rows[type].assign(wordsPerRow * height, 0);
+			columns[type].assign(wordsPerColumn * width, 0);
+		}
+
+		Uint64 rowBit = (Uint64)1 << (tileX & 63);
+		Uint64 columnBit = (Uint64)1 << (tileY & 63);
+		Uint64& rowWord = rows[type][tileY * wordsPerRow + tileX / 64];
+		Uint64& columnWord = columns[type][tileX * wordsPerColumn + tileY / 64];
+		rowWord = occupied ? rowWord | rowBit : rowWord & ~rowBit;
+		columnWord = occupied ? columnWord | columnBit : columnWord & ~columnBit;
+	}
+
+	//true if the tile holds an entity of the given type, tiles outside the level are free
+	bool IsSet(int tileX, int tileY, Uint16 type) const
+	{
+		if (tileX < 0 || tileY < 0 || tileX >= width || tileY >= height || type >= rows.size() || rows[type].empty())
+			return false;
+		return (rows[type][tileY * wordsPerRow + tileX / 64] >> (tileX & 63)) & 1;
+	}
+
+	//true if any tile in the inclusive range holds an entity of the given type
+	bool AnySet(int minX, int minY, int maxX, int maxY, Uint16 type) const
+	{
+		for (int y = minY; y <= maxY; y++)
+		{
+			int hit;
+			if (FirstInRow(y, minX, maxX, type, hit))
+				return true;
+		}
+		return false;
+	}
+
+	//first occupied tile of a row walking from fromX to toX (either direction), returns false if the span is free
+	bool FirstInRow(int tileY, int fromX, int toX, Uint16 type, int& hitX) const
+	{
+		if (tileY < 0 || tileY >= height || type >= rows.size() || rows[type].empty())
+			return false;
+		return ScanSpan(&rows[type][tileY * wordsPerRow], width, fromX, toX, hitX);
+	}
+
+	//first occupied tile of a column walking from fromY to toY (either direction), returns false if the span is free
+	bool FirstInColumn(int tileX, int fromY, int toY, Uint16 type, int& hitY) const
+	{
+		if (tileX < 0 || tileX >= width || type >= columns.size() || columns[type].empty())
+			return false;
+		return ScanSpan(&columns[type][tileX * wordsPerColumn], height, fromY, toY, hitY);
+	}
+
+	//tile containing a world coordinate, tiles are centered on the entities sitting on them
+	static int TileOf(float coordinate)
+	{
+		return (int)floorf((coordinate + ENTITYSIZE / 2) / ENTITYSIZE);
+	}
+
+private:
+	int width = 0, height = 0;
+	int wordsPerRow = 0, wordsPerColumn = 0;
+	std::vector<std::vector<Uint64>> rows; //indexed by type
+	std::vector<std::vector<Uint64>> columns; //indexed by type
+
+	//finds the first set bit of a line of bits between from and to, whole words are skipped when they are empty
+	static bool ScanSpan(const Uint64* words, int length, int from, int to, int& hit)
+	{
+		bool forward = from <= to;
+		int lo = SDL_max(SDL_min(from, to), 0);
+		int hi = SDL_min(SDL_max(from, to), length - 1);
+		if (lo > hi)
+			return false;
+
+		if (forward)
+		{
+			for (int word = lo / 64; word <= hi / 64; word++)
+			{
+				Uint64 bits = words[word];
+				if (word == lo / 64)
+					bits &= ~(Uint64)0 << (lo & 63);
+				if (word == hi / 64 && (hi & 63) != 63)
+					bits &= ((Uint64)1 << ((hi & 63) + 1)) - 1;
+				if (bits)
+				{
+					hit = word * 64 + LowestBit(bits);
+					return true;
+				}
+			}
+		}
+		else
+		{
+			for (int word = hi / 64; word >= lo / 64; word--)
+			{
+				Uint64 bits = words[word];
+				if (word == lo / 64)
+					bits &= ~(Uint64)0 << (lo & 63);
+				if (word == hi / 64 && (hi & 63) != 63)
+					bits &= ((Uint64)1 << ((hi & 63) + 1)) - 1;
+				if (bits)
+				{
+					hit = word * 64 + HighestBit(bits);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//a fixed set of threads that run the tasks of a ParallelFor together with the calling thread
+//tasks are handed out in order from a shared counter, so which thread runs a task is up to the scheduler:
+//jobs that need reproducible results should write to per task outputs and merge them in task order afterwards
+class WorkerPool
+{
+public:
+	WorkerPool()
+	{
+	}
+
+	~WorkerPool()
+	{
+		Stop();
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+public:
+	//starts the pool, threadCount counts the calling thread too so 1 means ParallelFor runs everything on the caller
+	void Start(int threadCount)
+	{
+		Stop();
+		stopping = false;
+		for (int i = 1; i < threadCount; i++)
+			workers.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+	}
+
+	//waits for the workers to exit
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+		workers.clear();
+	}
+
+	//number of threads running tasks, including the calling one
+	int ThreadCount() const
+	{
+		return (int)workers.size() + 1;
+	}
+
+	//runs job(0) to job(taskCount - 1) across the pool and returns once they are all done
+	void ParallelFor(int taskCount, const std::function<void(int)>& job)
+	{
+		if (workers.empty() || taskCount <= 1)
+		{
+			for (int task = 0; task < taskCount; task++)
+				job(task);
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		//a worker that woke up late for the previous batch must be out of it before its counters are reset
+		done.wait(lock, [this] { return busy == 0; });
+		currentJob = &job;
+		tasks = taskCount;
+		pending = taskCount;
+		nextTask = 0;
+		generation++;
+		lock.unlock();
+		wake.notify_all();
+
+		RunTasks();
+
+		lock.lock();
+		done.wait(lock, [this] { return pending == 0 && busy == 0; });
+		currentJob = NULL;
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake; //a new batch of tasks or Stop
+	std::condition_variable done; //the last task of the batch finished
+	bool stopping = false;
+	unsigned long long generation = 0; //batches started so far
+	int busy = 0; //workers inside RunTasks
+
+	const std::function<void(int)>* currentJob = NULL;
+	std::atomic<int> tasks { 0 };
+	std::atomic<int> nextTask { 0 };
+	std::atomic<int> pending { 0 };
+
+	void WorkerLoop()
+	{
+		unsigned long long seen = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+				busy++;
+			}
+			RunTasks();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				busy--;
+			}
+			done.notify_all();
+		}
+	}
+
+	//takes tasks from the shared counter until there are none left
+	void RunTasks()
+	{
+		while (true)
+		{
+			int task = nextTask.fetch_add(1);
+			if (task >= tasks)
+				return;
+
+			(*currentJob)(task);
+			if (pending.fetch_sub(1) == 1)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				done.notify_all();
+			}
+		}
+	}
+};